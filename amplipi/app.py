@@ -22,26 +22,38 @@ This serves the amplipi webpp and underlying rest api, that it uses.
 Flask is used to simplify the web plumbing.
 """
 
-from flask import Flask, request, render_template, jsonify, make_response, send_file
+from flask import Flask, request, render_template, jsonify, make_response, send_file, abort
 import amplipi.ctrl as ctrl
 import amplipi.rt as rt
 import amplipi.utils as utils
+from amplipi.thumbs import Thumb, THUMB_MIMETYPES, make_thumb
 import json
-from collections import OrderedDict
+from collections import OrderedDict, namedtuple
 
 # For keypads
 from PIL import Image
 import urllib.request
+import hashlib
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
 
 DEBUG_API = False
 
 # start in the web directory (where everythins is layed out for flask)
 import os
+
+try:
+  import msgpack # optional, lets the touchscreen controllers ask for MessagePack
+except ImportError:
+  msgpack = None
 template_dir = os.path.abspath('web/templates')
 static_dir = os.path.abspath('web/static')
 
 app = Flask(__name__, static_folder=static_dir, template_folder=template_dir)
 app.api = None # TODO: assign an unloaded API here to get auto completion / linting
+app.thumbs = None
+app.controller_docs = None
 
 # Helper functions
 def unused_groups(src):
@@ -90,6 +102,22 @@ def song_info(src):
 def get_status():
   return make_response(jsonify(app.api.get_state()))
 
+def wants_msgpack():
+  """ Whether the client prefers MessagePack to JSON (Accept: application/msgpack) """
+  if msgpack is None:
+    return False
+  return request.accept_mimetypes.best_match(['application/json', 'application/msgpack']) == 'application/msgpack'
+
+def data_response(data, code=200):
+  """ data as JSON, or MessagePack when the client asks for it """
+  if wants_msgpack():
+    resp = make_response(msgpack.packb(data), code)
+    resp.headers['Content-Type'] = 'application/msgpack'
+  else:
+    resp = make_response(jsonify(data), code)
+  resp.vary.add('Accept')
+  return resp
+
 def code_response(resp):
   if resp is None:
     # general commands return None to indicate success
@@ -107,9 +135,9 @@ def get_source(src):
   # TODO: add get_X capabilities to underlying API?
   sources = app.api.get_state()['sources']
   if src >= 0 and src < len(sources):
-    return sources[src]
+    return data_response(sources[src])
   else:
-    return {}, 404
+    return data_response({}, 404)
 
 @app.route('/api/sources/<int:src>', methods=['PATCH'])
 def set_source(src):
@@ -121,9 +149,9 @@ def set_source(src):
 def get_zone(zone):
   zones = app.api.get_state()['zones']
   if zone >= 0 and zone < len(zones):
-    return zones[zone]
+    return data_response(zones[zone])
   else:
-    return {}, 404
+    return data_response({}, 404)
 
 @app.route('/api/zones/<int:zone>', methods=['PATCH'])
 def set_zone(zone):
@@ -162,9 +190,9 @@ def create_stream():
 def get_stream(sid):
   _, stream = utils.find(app.api.get_state()['streams'], sid)
   if stream is not None:
-    return stream
+    return data_response(stream)
   else:
-    return {}, 404
+    return data_response({}, 404)
 
 @app.route('/api/streams/<int:sid>', methods=['PATCH'])
 def set_stream(sid):
@@ -178,39 +206,389 @@ def delete_stream(sid):
 def exec_command(sid, cmd):
   return code_response(app.api.exec_stream_command(id=sid, cmd=cmd))
 
+LOCAL_IMG = '/home/pi/web/static/imgs/rca_inputs.jpg'
+
+class ThumbCache:
+  """ Thumbnails keyed by source url, size and format.
+
+  Recently used thumbnails are kept in memory, and more of them on disk. The disk tier has its own
+  budget, and the files used least recently (by mtime, which loading refreshes) go first. Fetching and scaling runs on a small
+  pool of workers, and requests for a thumbnail that is already being made wait for that one instead
+  of starting their own, so many panels switching to the same stream cost a single fetch.
+  The last few downloaded originals are kept too, since panels ask for a small preview and then the
+  full size image of the same art.
+  """
+
+  def __init__(self, cache_dir='/tmp/amplipi-thumbs', max_bytes=4*1024*1024, disk_max_bytes=32*1024*1024, workers=2, max_originals=8):
+    self.cache_dir = cache_dir
+    self.max_bytes = max_bytes
+    self.disk_max_bytes = disk_max_bytes
+    self.max_originals = max_originals
+    self.mem = OrderedDict() # key -> Thumb, least recently used first
+    self.mem_bytes = 0
+    self.originals = OrderedDict() # url -> downloaded bytes, least recently used first
+    self.pending = {} # key -> Future
+    self.lock = threading.Lock()
+    self.pool = ThreadPoolExecutor(max_workers=workers)
+    os.makedirs(cache_dir, exist_ok=True)
+
+  @staticmethod
+  def key(src, width, height, fmt):
+    if not (src.startswith('http://') or src.startswith('https://')):
+      # local files can change in place
+      src = '{}@{}'.format(src, os.path.getmtime(src))
+    return '{}|{}x{}|{}'.format(src, width, height, fmt)
+
+  def _path(self, key):
+    return os.path.join(self.cache_dir, hashlib.sha1(key.encode()).hexdigest())
+
+  def _remember(self, key, thumb):
+    """ Add to the memory tier, dropping the least recently used thumbnails to stay in budget. Call with lock held. """
+    if key in self.mem:
+      return
+    self.mem[key] = thumb
+    self.mem_bytes += len(thumb.data)
+    while self.mem_bytes > self.max_bytes and len(self.mem) > 1:
+      _, old = self.mem.popitem(last=False)
+      self.mem_bytes -= len(old.data)
+
+  def _load(self, key):
+    """ Disk tier. The file name is a hash of the key, the header line holds the rest of the Thumb. """
+    try:
+      with open(self._path(key), 'rb') as f:
+        kind, width, height, etag = f.readline().decode().split()
+        thumb = Thumb(f.read(), kind, int(width), int(height), etag)
+      os.utime(self._path(key)) # recently used, keep it longer
+      return thumb
+    except (OSError, ValueError):
+      return None
+
+  def _store(self, key, thumb):
+    tmp = self._path(key) + '.tmp'
+    with open(tmp, 'wb') as f:
+      f.write('{} {} {} {}\n'.format(thumb.kind, thumb.width, thumb.height, thumb.etag).encode())
+      f.write(thumb.data)
+    os.replace(tmp, self._path(key))
+    self._prune()
+
+  def _prune(self):
+    """ Remove the least recently used files until the disk tier is within its budget """
+    files = []
+    total = 0
+    for entry in os.scandir(self.cache_dir):
+      if entry.name.endswith('.tmp'):
+        continue # still being written
+      try:
+        st = entry.stat()
+      except OSError:
+        continue # removed by another worker
+      files.append((st.st_mtime, st.st_size, entry.path))
+      total += st.st_size
+    files.sort()
+    for _, size, path in files:
+      if total <= self.disk_max_bytes:
+        break
+      try:
+        os.remove(path)
+      except OSError:
+        pass
+      total -= size
+
+  def _original(self, src):
+    """ Downloaded image for a url, or the file name of a local image """
+    if not (src.startswith('http://') or src.startswith('https://')):
+      return src
+    with self.lock:
+      data = self.originals.get(src)
+      if data is not None:
+        self.originals.move_to_end(src)
+        return data
+    with urllib.request.urlopen(src, timeout=10) as resp:
+      data = resp.read()
+    with self.lock:
+      self.originals[src] = data
+      while len(self.originals) > self.max_originals:
+        self.originals.popitem(last=False)
+    return data
+
+  def _make(self, key, src, width, height, fmt):
+    try:
+      thumb = self._load(key)
+      if thumb is None:
+        thumb = make_thumb(self._original(src), width, height, fmt)
+        self._store(key, thumb)
+      with self.lock:
+        self._remember(key, thumb)
+      return thumb
+    finally:
+      with self.lock:
+        self.pending.pop(key, None)
+
+  def get(self, src, width, height, fmt, timeout=30):
+    """ Get a thumbnail, making it if needed. Raises on failure. """
+    key = self.key(src, width, height, fmt)
+    with self.lock:
+      thumb = self.mem.get(key)
+      if thumb is not None:
+        self.mem.move_to_end(key)
+        return thumb
+      future = self.pending.get(key)
+      if future is None:
+        future = self.pool.submit(self._make, key, src, width, height, fmt)
+        self.pending[key] = future
+    return future.result(timeout=timeout)
+
+def art_key(url):
+  """ 32 bit FNV-1a of an image url, the key controllers file their art cache under (artKey() in the firmware) """
+  h = 2166136261
+  for b in url.encode():
+    h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+  return h
+
+def thumb_response(src, width, height, fmt):
+  """ Send a cached thumbnail, or 304 if the client already has it.
+    A url_hash query parameter names the image the client wants, by art_key() of its url. If src is
+    another image by now (the track changed since the request was queued), the answer is 404, so the
+    client doesn't file the wrong image under its key.
+  """
+  url_hash = request.args.get('url_hash')
+  if url_hash is not None:
+    try:
+      if int(url_hash, 16) != art_key(src):
+        abort(404)
+    except ValueError:
+      abort(400)
+  try:
+    thumb = app.thumbs.get(src, width, height, fmt)
+  except Exception as e:
+    print('failed to make thumbnail of {}: {}'.format(src, e))
+    abort(404)
+  resp = make_response(thumb.data)
+  resp.headers['Content-Type'] = THUMB_MIMETYPES[thumb.kind]
+  resp.headers['X-Image-Width'] = str(thumb.width)
+  resp.headers['X-Image-Height'] = str(thumb.height)
+  resp.headers['Cache-Control'] = 'max-age=3600'
+  resp.set_etag(thumb.etag)
+  return resp.make_conditional(request)
+
+def image_args(width):
+  """ Size and format query parameters shared by the image routes, see get_source_image """
+  height = request.args.get('height', width, type=int)
+  fmt = request.args.get('format', 'jpg')
+  if width <= 0 or width > 1024 or height <= 0 or height > 1024 or fmt not in THUMB_MIMETYPES:
+    abort(400)
+  return height, fmt
+
 @app.route('/api/streams/image/<int:sid>', methods=['GET'])
 def get_stream_image(sid):
+  """ A stream's logo. Takes width as a query parameter (default 200), and the same height and format as get_source_image """
   _, stream = utils.find(app.api.get_state()['streams'], sid)
-  width = 200
-  if stream is not None:
-    img_tmp = '/tmp/{}'.format(os.path.basename(stream['logo']))
-    img_tmp_jpg = img_tmp + '.jpg'
-    if not os.path.exists(img_tmp_jpg):
-        urllib.request.urlretrieve(stream['logo'], img_tmp)
-        size = width, width
-        img = Image.open(img_tmp)
-        img.thumbnail(size)
-        img = img.convert(mode="RGB")
-        img.save(img_tmp_jpg)
-        os.remove(img_tmp);
+  width = request.args.get('width', 200, type=int)
+  height, fmt = image_args(width)
+  if stream is not None and stream.get('logo'):
+    return thumb_response(stream['logo'], width, height, fmt)
+  else:
+    return thumb_response(LOCAL_IMG, width, height, fmt)
+
+@app.route('/api/sources/<int:src>/image/<int:width>', methods=['GET'])
+def get_source_image(src, width):
+  """ Album art, or the stream's logo, for what is playing on a source.
+    Query parameters:
+      height: height of the box to fit the image in, defaults to width
+      format: jpg (default), rgb565 or rle565. The RGB565 formats are padded to exactly width x height.
+      next: 1 for the upcoming track's art, if the stream knows it (404 if not)
+      url_hash: art_key() of the image url expected, 404 if it's a different image now
+  """
+  sources = app.api.get_state()['sources']
+  if src < 0 or src >= len(sources):
+    abort(404)
+  height, fmt = image_args(width)
 
-    try:
-      return send_file(img_tmp_jpg, mimetype='image/jpg', as_attachment=False)
-    except FileNotFoundError:
+  info = song_info(src)
+  if request.args.get('next', 0, type=int):
+    if not info.get('next_img_url'):
       abort(404)
-      
-  else:
-    local_img = '/home/pi/web/static/imgs/rca_inputs.jpg'
-    img_tmp_jpg = local_img + '-' + width + '.jpg'
+    return thumb_response(info['next_img_url'], width, height, fmt)
+
+  img_src = info['img_url']
+  if not img_src and sources[src]['input'].startswith('stream='):
+    _, stream = utils.find(app.api.get_state()['streams'], int(sources[src]['input'][len('stream='):]))
+    if stream is not None:
+      img_src = stream.get('logo')
+  return thumb_response(img_src or LOCAL_IMG, width, height, fmt)
+
+# touchscreen controllers
+
+CONTROLLER_DOC_TTL = 0.2 # seconds a document is shared before it's checked against the state again
+CHANGES_CHECK_INTERVAL = 0.5 # seconds between checks for stream changes while controllers are waiting
+CHANGES_TIMEOUT = 25 # seconds a long poll is held by default when nothing changes
+CHANGES_TIMEOUT_MAX = 60
+
+ControllerDoc = namedtuple('ControllerDoc', ['checked', 'generation', 'doc', 'body', 'packed', 'etag', 'version'])
+
+def controller_doc(src, zones):
+  """ What a controller shows for a source and a list of zone ids, or None if there's no such source """
+  state = app.api.get_state()
+  if src < 0 or src >= len(state['sources']):
+    return None
+  source = state['sources'][src]
+  stream = None
+  if source['input'].startswith('stream='):
+    _, s = utils.find(state['streams'], int(source['input'][len('stream='):]))
+    if s is not None:
+      stream = { 'id': s['id'], 'name': s['name'], 'type': s['type'] }
+  src_doc = { 'id': src, 'input': source['input'], 'info': dict(song_info(src)) }
+  if 'status' in source:
+    src_doc['status'] = source['status']
+  by_id = { z['id']: z for z in state['zones'] }
+  zone_docs = [ { 'id': z, 'vol': by_id[z]['vol'], 'mute': by_id[z]['mute'] } for z in zones if z in by_id ]
+  return { 'source': src_doc, 'stream': stream, 'zones': zone_docs }
+
+class ControllerDocs:
+  """ Compact status documents for the touchscreen controllers, one per source and zone list.
+    A document is only serialized again when what it holds changes, and controllers asking within
+    CONTROLLER_DOC_TTL of each other share it without it being rebuilt. Changes made through the API
+    are seen straight away, changes from the streams (new tracks) within CONTROLLER_DOC_TTL.
+
+    Controllers can also wait for their document to change (see /api/changes). While any are waiting, a
+    watcher thread rebuilds their documents after every API change and every CHANGES_CHECK_INTERVAL.
+  """
+
+  def __init__(self):
+    self.lock = threading.Lock()
+    self.changed = threading.Condition(self.lock) # notified when a document gets a new version
+    self.docs = {} # (src, zones) -> ControllerDoc
+    self.generation = 0 # bumped by every change made through the API
+    self.version = 0 # bumped whenever any document changes
+    self.waiting = {} # (src, zones) -> number of controllers waiting for it to change
+    self.wake = threading.Event()
+    self.watcher = None
+
+  def invalidate(self):
+    with self.lock:
+      self.generation += 1
+    self.wake.set()
+
+  def get(self, src, zones):
+    key = (src, zones)
+    now = time.monotonic()
+    with self.lock:
+      cached = self.docs.get(key)
+      if cached and cached.generation == self.generation and now - cached.checked < CONTROLLER_DOC_TTL:
+        return cached
+      generation = self.generation
+    doc = controller_doc(src, zones)
+    if doc is None:
+      return None
+    with self.lock:
+      cached = self.docs.get(key)
+      if cached and cached.doc == doc:
+        cached = cached._replace(checked=now, generation=generation)
+      else:
+        self.version += 1
+        versioned = dict(doc, version=self.version)
+        body = json.dumps(versioned, separators=(',', ':')).encode()
+        packed = msgpack.packb(versioned) if msgpack is not None else None
+        cached = ControllerDoc(now, generation, doc, body, packed, hashlib.md5(body).hexdigest(), self.version)
+        self.changed.notify_all()
+      self.docs[key] = cached
+      return cached
+
+  def wait(self, src, zones, since, timeout):
+    """ The document once its version differs from since, or the unchanged one after timeout. None if there's no such source.
+      A since from a different document, or from before the AmpliPi restarted, is answered straight away.
+    """
+    key = (src, zones)
+    deadline = time.monotonic() + timeout
+    # Registered before the first look, so the watcher rebuilds this document from then on and no change
+    # can land between the look and the wait unseen
+    with self.lock:
+      self.waiting[key] = self.waiting.get(key, 0) + 1
+      if self.watcher is None:
+        self.watcher = threading.Thread(target=self.watch, daemon=True)
+        self.watcher.start()
     try:
-      size = 200, 200
-      img = Image.open(local_img)
-      img.thumbnail(size)
-      img = img.convert(mode="RGB")
-      img.save(img_tmp_jpg)
-      return send_file(img_tmp_jpg, mimetype='image/jpg', as_attachment=False)
-    except FileNotFoundError:
-      abort(404)
+      cached = self.get(src, zones)
+      if cached is None:
+        return None
+      with self.lock:
+        while True:
+          # Re-read under the lock, a change made since the last look has already been notified
+          cached = self.docs.get(key, cached)
+          remaining = deadline - time.monotonic()
+          if cached.version != since or remaining <= 0:
+            break
+          self.changed.wait(remaining)
+    finally:
+      with self.lock:
+        self.waiting[key] -= 1
+        if self.waiting[key] == 0:
+          del self.waiting[key]
+    return cached
+
+  def watch(self):
+    """ Rebuild the documents controllers are waiting on, so they hear about changes """
+    while True:
+      self.wake.wait(CHANGES_CHECK_INTERVAL)
+      self.wake.clear()
+      with self.lock:
+        keys = list(self.waiting)
+      for src, zones in keys:
+        self.get(src, zones)
+
+@app.after_request
+def invalidate_controller_docs(resp):
+  """ Anything but a GET may have changed the state """
+  if request.method != 'GET' and request.path.startswith('/api/') and app.controller_docs is not None:
+    app.controller_docs.invalidate()
+  return resp
+
+def controller_zones():
+  """ Zone ids from the zones query parameter (comma separated) """
+  return tuple(int(z) for z in request.args.get('zones', '').split(',') if z.strip().isdigit())
+
+def controller_response(cached):
+  if wants_msgpack():
+    resp = make_response(cached.packed)
+    resp.headers['Content-Type'] = 'application/msgpack'
+    resp.set_etag(cached.etag + '-msgpack')
+  else:
+    resp = make_response(cached.body)
+    resp.headers['Content-Type'] = 'application/json'
+    resp.set_etag(cached.etag)
+  resp.vary.add('Accept')
+  resp.headers['X-State-Version'] = str(cached.version)
+  return resp.make_conditional(request)
+
+@app.route('/api/controller/<int:src>', methods=['GET'])
+def get_controller(src):
+  """ Everything a touchscreen controller shows: the source's input and song info, its stream's name and type,
+    and vol and mute of the zones listed in the zones query parameter (comma separated ids).
+    An unknown source is 422, controllers take a 404 to mean this AmpliPi has no controller route.
+  """
+  cached = app.controller_docs.get(src, controller_zones())
+  if cached is None:
+    abort(422)
+  return controller_response(cached)
+
+@app.route('/api/changes', methods=['GET'])
+def get_changes():
+  """ Long poll for touchscreen controllers. Query parameters:
+      source, zones: as for /api/controller
+      since: version of the document the controller has (its X-State-Version), 0 for none
+      timeout: seconds to wait for a change, default CHANGES_TIMEOUT
+    Answers with the /api/controller document as soon as its version differs from since, or 204 after the timeout.
+    An unknown source is 422, as for /api/controller.
+  """
+  src = request.args.get('source', 0, type=int)
+  since = request.args.get('since', 0, type=int)
+  timeout = min(request.args.get('timeout', CHANGES_TIMEOUT, type=float), CHANGES_TIMEOUT_MAX)
+  cached = app.controller_docs.wait(src, controller_zones(), since, timeout)
+  if cached is None:
+    abort(422)
+  if cached.version == since:
+    return '', 204
+  return controller_response(cached)
 
 # presets
 
@@ -265,6 +643,8 @@ def create_app(mock_ctrl=False, mock_streams=False, config_file='config/house.js
     app.api = ctrl.Api(rt.Mock(), mock_streams=mock_streams, config_file=config_file)
   else:
     app.api = ctrl.Api(rt.Rpi(), mock_streams=mock_streams, config_file=config_file)
+  app.thumbs = ThumbCache()
+  app.controller_docs = ControllerDocs()
   return app
 
 if __name__ == '__main__':
@@ -0,0 +1,73 @@
+"""Thumbnails for the touchscreen controllers
+
+Scales album art and stream logos and encodes them as JPEG or as RGB565 pixels (raw or run length
+encoded) that the controllers push straight to the display. Kept apart from the webapp so tools can
+produce the exact bytes the AmpliPi sends without Flask.
+"""
+
+from collections import namedtuple
+from PIL import Image
+import hashlib
+import io
+import struct
+
+def rgb565(img):
+  """ Convert an RGB image to RGB565 pixels, big endian (the byte order the display takes) """
+  return [((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3) for r, g, b in img.getdata()]
+
+def rgb565_raw(pixels):
+  return struct.pack('>{}H'.format(len(pixels)), *pixels)
+
+def rgb565_rle(pixels):
+  """ Run length encode RGB565 pixels as (count, pixel) pairs of big endian 16 bit values. Runs continue across rows. """
+  runs = []
+  count = 0
+  last = None
+  for p in pixels:
+    if p == last and count < 0xFFFF:
+      count += 1
+    else:
+      if last is not None:
+        runs += [count, last]
+      last = p
+      count = 1
+  if last is not None:
+    runs += [count, last]
+  return struct.pack('>{}H'.format(len(runs)), *runs)
+
+# Encoded image, ready to send. kind is jpg, rgb565 or rle565 (what rle565 requests got may be rgb565).
+Thumb = namedtuple('Thumb', ['data', 'kind', 'width', 'height', 'etag'])
+
+THUMB_MIMETYPES = {
+  'jpg': 'image/jpg',
+  'rgb565': 'application/x-rgb565',
+  'rle565': 'application/x-rgb565-rle',
+}
+
+def make_thumb(original, width, height, fmt):
+  """ Scale an image (downloaded bytes, or a local file name) to fit inside width x height.
+    The RGB565 formats are padded to exactly width x height so the image covers the box on screen.
+    rle565 falls back to raw RGB565 if run length encoding doesn't make it smaller.
+  """
+  img = Image.open(io.BytesIO(original) if isinstance(original, bytes) else original)
+  img.thumbnail((width, height))
+  img = img.convert(mode='RGB')
+
+  if fmt == 'jpg':
+    out = io.BytesIO()
+    img.save(out, format='JPEG')
+    data, kind = out.getvalue(), 'jpg'
+  else:
+    if img.size != (width, height):
+      canvas = Image.new('RGB', (width, height))
+      canvas.paste(img, ((width - img.width) // 2, (height - img.height) // 2))
+      img = canvas
+    pixels = rgb565(img)
+    data, kind = rgb565_raw(pixels), 'rgb565'
+    if fmt == 'rle565':
+      rle = rgb565_rle(pixels)
+      if len(rle) < len(data):
+        data, kind = rle, 'rle565'
+  # the etag only depends on the content, so it's the same for every panel and survives restarts
+  etag = hashlib.sha1(data).hexdigest()[:16]
+  return Thumb(data, kind, img.width, img.height, etag)
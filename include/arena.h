@@ -0,0 +1,85 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Memory for the JSON documents and strings a refresh or a screen needs while it runs. Each arena is one
+// block taken from the heap at boot. Allocating moves a pointer, and everything is freed at once when the
+// ArenaScope that covers it ends, so the heap isn't fragmented by documents of different sizes coming and
+// going every refresh.
+#define REFRESH_ARENA_SIZE 12288 // Zone, source and stream documents of one loop() pass
+#define SCREEN_ARENA_SIZE 8192   // Documents of a screen being drawn, the stream list is the largest
+
+#define ARENA_ALIGN 4
+
+struct Arena {
+    const char *name;
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t peak;
+};
+
+// Used from loop() only, other tasks allocate from the heap
+extern Arena refreshArena;
+extern Arena screenArena;
+
+// Take the arenas from the heap. Without them, allocations fall back to the heap.
+void arenaBegin();
+
+// size bytes from the arena, or NULL if it's full
+void *arenaAlloc(Arena &arena, size_t size);
+
+// Free everything allocated from the arena
+void arenaReset(Arena &arena);
+
+// Whether ptr came from the arena
+bool arenaOwns(const Arena &arena, const void *ptr);
+
+// Format into the arena, like snprintf. Returns NULL if the arena is full or wasn't taken, there is no heap
+// fallback because nothing would free the string. Callers skip what needed it.
+const char *arenaPrintf(Arena &arena, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Everything allocated from the arena while the scope lives is freed when it ends
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena &arena) : arena(arena), mark(arena.used) {}
+    ~ArenaScope() { arena.used = mark; }
+
+private:
+    Arena &arena;
+    size_t mark;
+};
+
+// ArduinoJson allocator for BasicJsonDocument. A document that doesn't fit in the arena goes on the heap.
+template <Arena &arena>
+struct ArenaAllocator {
+    void *allocate(size_t size)
+    {
+        void *ptr = arenaAlloc(arena, size);
+        return ptr != NULL ? ptr : malloc(size);
+    }
+
+    void deallocate(void *ptr)
+    {
+        // Arena memory is freed by the ArenaScope
+        if (!arenaOwns(arena, ptr)) {
+            free(ptr);
+        }
+    }
+
+    void *reallocate(void *ptr, size_t size)
+    {
+        // Only used by shrinkToFit(), which never grows a document
+        if (!arenaOwns(arena, ptr)) {
+            return realloc(ptr, size);
+        }
+        return ptr;
+    }
+};
+
+typedef BasicJsonDocument<ArenaAllocator<refreshArena> > RefreshJsonDocument;
+typedef BasicJsonDocument<ArenaAllocator<screenArena> > ScreenJsonDocument;
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef ARTCACHE_H
+#define ARTCACHE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Album art and stream logos kept on flash as RGB565, so they can be drawn without the network.
+// Files are named by a hash of the image url and the width they were scaled to.
+#define ART_CACHE_DIR "/art/"
+
+// Flash space the cache may use, and the largest single image kept (in bytes)
+#define ART_CACHE_BUDGET 65536
+#define ART_CACHE_ENTRY_MAX 24576
+
+// Most images kept at once
+#define ART_CACHE_ENTRIES 24
+
+// Prefetches waiting to run
+#define ART_PREFETCH_QUEUE 16
+
+// Prefetches that failed (a 404 for art that is no longer next, an image too big to keep) are remembered,
+// the most recent this many, and not queued again for ART_PREFETCH_RETRY (in milliseconds)
+#define ART_PREFETCH_FAILED 8
+#define ART_PREFETCH_RETRY 300000
+
+// Prefetching waits until the panel hasn't been touched for this long (in milliseconds)
+#define ART_PREFETCH_IDLE 5000
+
+// Header at the start of each cached image
+struct ArtHeader {
+    uint16_t width;
+    uint16_t height;
+    uint16_t rle; // 1 if run length encoded
+};
+
+// Cache key for an image url
+uint32_t artKey(const String &url);
+
+// Load the cache index from flash and start the prefetch task. hostIP returns the AmpliPi address, or "" if unknown.
+void artCacheBegin(String (*hostIP)());
+
+bool artCacheHas(uint32_t key, uint16_t width);
+
+// Open a cached image for reading, positioned after the header
+bool artCacheOpen(uint32_t key, uint16_t width, File *file, ArtHeader *header);
+
+// Make room for an image of size bytes and open a file to write it to. Finish with artCacheFinish().
+File artCacheCreate(uint32_t key, const ArtHeader &header, size_t size);
+void artCacheFinish(uint32_t key, uint16_t width, File &file, bool ok);
+
+// Fetch an image in the background. apiPath is requested from the AmpliPi API and must return RGB565 at width.
+// Returns false if it's cached, already queued, failed recently or the queue is full.
+bool artPrefetch(uint32_t key, uint16_t width, const String &apiPath);
+
+// Call when the panel is touched, prefetching waits for things to go quiet
+void artActivity();
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <layout.h>
+
+// The main screen as it was when the screen turned off, read back from the panel and run length encoded
+// in RAM. Waking pushes it in one pass instead of decoding the icons and art from flash again, and the
+// refresh that follows only draws what changed.
+#define FRAME_CACHE_BUDGET 49152 // Most RAM a frame may take (in bytes), bigger frames aren't kept
+#define FRAME_READ_ROWS 4        // Rows read back from the panel at a time
+
+// Read the screen back and keep it, leaving out skip (which may be empty). Returns false if the panel
+// can't be read or the frame doesn't fit the budget. Call with the display held.
+bool frameCacheSave(TFT_eSPI *display, const Rect &skip);
+
+// Push the kept frame, leaving the skipped area as it is. Returns false if there isn't one for the
+// current rotation. Call with the display held.
+bool frameCacheDraw(TFT_eSPI *display);
+
+// Free the frame
+void frameCacheClear();
+
+#endif
@@ -0,0 +1,318 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+
+// Screen geometry. Every rectangle the screens draw in and take touches from is worked out here from the
+// panel size and rotation, at compile time, so drawing and hit testing use the same numbers and another
+// panel size needs no edits. Sizes of the bitmaps and fonts are fixed, the space between them adapts.
+// Portrait stacks the art, text and volume bars. Landscape puts the art on the left and the rest in a
+// column beside it.
+
+#define ICON_SIZE 36       // Bitmap buttons (power, source, stream commands)
+#define BAR_H 50           // Source bar at the top
+#define BUTTON_W 130       // Back/Next, Save/Cancel and Close buttons at the bottom
+#define BUTTON_H 50
+#define GEAR_W 44          // Settings button between the bottom buttons
+#define ALBUMART_MAX 200   // Largest album art, which is also the height of the art row on the metadata screen
+#define METATEXT_H 90      // Song and artist lines
+#define METALINE_H 26      // Height of the song and artist lines
+#define VOLUME_AREA_H 87   // Warning line, mute buttons and volume bars at the bottom
+#define VOLBAR_H 6
+#define MUTE_SIZE 50
+#define SETTING_PITCH 40   // Distance between rows on the settings screen
+#define STEP_BUTTON 36     // < and > buttons on the settings screen
+#define SOURCEITEM_H 54    // Distance between rows of the source list
+#define SOURCEBOX_H 38     // Height of the box drawn for each row
+
+struct Rect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+
+    constexpr int right() const { return x + w; }
+    constexpr int bottom() const { return y + h; }
+    constexpr bool contains(int px, int py) const { return px >= x && px < (x + w) && py >= y && py < (y + h); }
+};
+
+constexpr Rect rect(int x, int y, int w, int h)
+{
+    return Rect{ int16_t(x), int16_t(y), int16_t(w), int16_t(h) };
+}
+
+struct Layout {
+    Rect screen;
+    Rect srcBar;          // Stream name with the power and source buttons
+    Rect powerButton;
+    Rect srcButton;       // Oversized for easy selection, the icon is in its top right corner
+    Rect mainZone;        // Below the source bar, where the screens draw
+
+    Rect leftButton;      // Bottom row of the source, settings, about and zone screens
+    Rect centerButton;
+    Rect rightButton;
+
+    Rect albumArt;        // Selection screen
+    Rect albumArtFull;    // Metadata screen, the art is centered in it
+    Rect likeButton;      // Stream commands, over the sides of the art row, or under the text in landscape
+    Rect dislikeButton;
+    Rect playPauseButton;
+    Rect skipButton;
+    Rect metaText;
+
+    Rect warnZone;        // Just above the volume bars
+    Rect mute1;           // Upper, used in two zone mode
+    Rect mute2;           // Lower
+    Rect volBar1;
+    Rect volBar2;
+    Rect volZone1;        // Touch area of the volume bars
+    Rect volZone2;
+
+    Rect sourceList;      // Between the source bar and the bottom buttons
+
+    Rect zone1Row;        // Settings: label, then the < and > buttons
+    Rect zone1Down;
+    Rect zone1Up;
+    Rect zone2Row;
+    Rect zone2Down;
+    Rect zone2Up;
+    Rect sourceRow;
+    Rect sourceDown;
+    Rect sourceUp;
+    Rect rebootButton;
+    Rect recalibrateButton;
+    Rect rotateButton;
+
+    Rect logo;            // AmpliPi name on the about screen
+};
+
+// Album art gets what's left of the height once the text and volume controls fit, and leaves room for
+// the stream command buttons beside it
+constexpr int layoutArtSize(int w, int h)
+{
+    return (h - BAR_H - 10 - METATEXT_H - VOLUME_AREA_H < ALBUMART_MAX && h - BAR_H - 10 - METATEXT_H - VOLUME_AREA_H < w - 2 * ICON_SIZE)
+        ? (h - BAR_H - 10 - METATEXT_H - VOLUME_AREA_H)
+        : ((w - 2 * ICON_SIZE < ALBUMART_MAX) ? (w - 2 * ICON_SIZE) : ALBUMART_MAX);
+}
+
+// Settings rows, from the top of the main zone
+constexpr Rect settingRow(int w, int row)
+{
+    return rect(0, BAR_H + row * SETTING_PITCH - 9, w - 2 * SETTING_PITCH, SETTING_PITCH - 2);
+}
+
+constexpr Rect settingStep(int w, int row, int step)
+{
+    return rect(w - (step < 0 ? 2 : 1) * SETTING_PITCH, BAR_H + row * SETTING_PITCH, STEP_BUTTON, STEP_BUTTON);
+}
+
+// The three full width buttons under the settings rows close up on short panels to stay clear of the bottom row
+constexpr int settingActionTop() { return BAR_H + 3 * SETTING_PITCH; }
+
+constexpr int settingActionPitch(int h)
+{
+    return ((h - BUTTON_H - settingActionTop()) / 3 < SETTING_PITCH) ? ((h - BUTTON_H - settingActionTop()) / 3) : SETTING_PITCH;
+}
+
+constexpr int settingActionGap(int h)
+{
+    return (h - BUTTON_H - settingActionTop() - 3 * settingActionPitch(h) < 10) ? (h - BUTTON_H - settingActionTop() - 3 * settingActionPitch(h)) : 10;
+}
+
+constexpr Rect settingAction(int w, int h, int row)
+{
+    return rect(0, settingActionTop() + settingActionGap(h) + row * settingActionPitch(h), w,
+        (settingActionPitch(h) - 4 < STEP_BUTTON) ? (settingActionPitch(h) - 4) : STEP_BUTTON);
+}
+
+// Stream commands stand two on each side of the art row. Art rows too short for the usual spacing (240x320
+// panels) get them spread evenly over their height instead.
+constexpr int portraitCommandY(int w, int h, int row)
+{
+    return (68 + ICON_SIZE <= layoutArtSize(w, h))
+        ? (BAR_H + 14 + row * 54)
+        : (BAR_H + (row + 1) * ((layoutArtSize(w, h) - 2 * ICON_SIZE) / 3) + row * ICON_SIZE);
+}
+
+constexpr Layout makePortraitLayout(int w, int h)
+{
+    return Layout{
+        rect(0, 0, w, h),
+        rect(0, 0, w, BAR_H),
+        rect(0, 0, ICON_SIZE + 4, ICON_SIZE + 4),
+        rect(w - ICON_SIZE - 4, 0, ICON_SIZE + 4, BAR_H),
+        rect(0, BAR_H, w, h - BAR_H),
+
+        rect(0, h - BUTTON_H, BUTTON_W, BUTTON_H),
+        rect((w - GEAR_W) / 2, h - 45, BUTTON_H, BUTTON_H),
+        rect(w - BUTTON_W, h - BUTTON_H, BUTTON_W, BUTTON_H),
+
+        rect((w - layoutArtSize(w, h)) / 2, BAR_H, layoutArtSize(w, h), layoutArtSize(w, h)),
+        rect(0, BAR_H, w, layoutArtSize(w, h)),
+        rect(0, portraitCommandY(w, h, 0), ICON_SIZE, ICON_SIZE),
+        rect(0, portraitCommandY(w, h, 1), ICON_SIZE, ICON_SIZE),
+        rect(w - ICON_SIZE, portraitCommandY(w, h, 0), ICON_SIZE, ICON_SIZE),
+        rect(w - ICON_SIZE, portraitCommandY(w, h, 1), ICON_SIZE, ICON_SIZE),
+        rect(0, BAR_H + layoutArtSize(w, h) + 10, w, METATEXT_H),
+
+        rect(0, h - VOLUME_AREA_H, w, 14),
+        rect(0, h - 73, MUTE_SIZE, MUTE_SIZE),
+        rect(0, h - MUTE_SIZE, MUTE_SIZE, MUTE_SIZE),
+        rect(45, h - 60, w - 90, VOLBAR_H),
+        rect(45, h - 23, w - 90, VOLBAR_H),
+        rect(MUTE_SIZE, h - 73, w - MUTE_SIZE, MUTE_SIZE),
+        rect(MUTE_SIZE, h - MUTE_SIZE, w - MUTE_SIZE, MUTE_SIZE),
+
+        rect(0, BAR_H, w, h - BUTTON_H - BAR_H),
+
+        settingRow(w, 0),
+        settingStep(w, 0, -1),
+        settingStep(w, 0, 1),
+        settingRow(w, 1),
+        settingStep(w, 1, -1),
+        settingStep(w, 1, 1),
+        settingRow(w, 2),
+        settingStep(w, 2, -1),
+        settingStep(w, 2, 1),
+        settingAction(w, h, 0),
+        settingAction(w, h, 1),
+        settingAction(w, h, 2),
+
+        rect(0, (h - BUTTON_H - 40 < 265) ? (h - BUTTON_H - 40) : 265, w, 30)
+    };
+}
+
+// Landscape art is as big as fits under the source bar in the left half
+constexpr int landscapeArtSize(int w, int h)
+{
+    return (h - BAR_H < w / 2) ? (h - BAR_H) : (w / 2);
+}
+
+// Song text and the warning line above the volume bars, in the column right of the art
+constexpr Rect landscapeMetaText(int w, int h)
+{
+    return rect(landscapeArtSize(w, h), BAR_H + 10, w - landscapeArtSize(w, h), METATEXT_H);
+}
+
+constexpr Rect landscapeWarnZone(int w, int h)
+{
+    return rect(landscapeArtSize(w, h), h - VOLUME_AREA_H, w - landscapeArtSize(w, h), 14);
+}
+
+// Stream commands share a row centered between the text and the warning line, spread across the column.
+// Panels 240 high have no room for the row, the commands are left out there: an empty Rect is never
+// drawn or touched.
+constexpr int landscapeCommandGap(int w, int h)
+{
+    return landscapeWarnZone(w, h).y - landscapeMetaText(w, h).bottom();
+}
+
+constexpr Rect landscapeCommand(int w, int h, int slot)
+{
+    return (landscapeCommandGap(w, h) < ICON_SIZE)
+        ? rect(0, 0, 0, 0)
+        : rect(landscapeArtSize(w, h) + slot * ((w - landscapeArtSize(w, h)) / 4) + ((w - landscapeArtSize(w, h)) / 4 - ICON_SIZE) / 2,
+            landscapeMetaText(w, h).bottom() + (landscapeCommandGap(w, h) - ICON_SIZE) / 2, ICON_SIZE, ICON_SIZE);
+}
+
+// The settings rows take the left half, their buttons go beside them in the right half
+constexpr Rect landscapeSettingAction(int w, int row)
+{
+    return rect(w / 2 + 10, BAR_H + row * SETTING_PITCH, w / 2 - 20, STEP_BUTTON);
+}
+
+constexpr Layout makeLandscapeLayout(int w, int h)
+{
+    return Layout{
+        rect(0, 0, w, h),
+        rect(0, 0, w, BAR_H),
+        rect(0, 0, ICON_SIZE + 4, ICON_SIZE + 4),
+        rect(w - ICON_SIZE - 4, 0, ICON_SIZE + 4, BAR_H),
+        rect(0, BAR_H, w, h - BAR_H),
+
+        rect(0, h - BUTTON_H, BUTTON_W, BUTTON_H),
+        rect((w - GEAR_W) / 2, h - 45, BUTTON_H, BUTTON_H),
+        rect(w - BUTTON_W, h - BUTTON_H, BUTTON_W, BUTTON_H),
+
+        rect(0, BAR_H, landscapeArtSize(w, h), landscapeArtSize(w, h)),
+        rect(0, BAR_H, landscapeArtSize(w, h), landscapeArtSize(w, h)),
+        landscapeCommand(w, h, 0),
+        landscapeCommand(w, h, 1),
+        landscapeCommand(w, h, 2),
+        landscapeCommand(w, h, 3),
+        landscapeMetaText(w, h),
+
+        landscapeWarnZone(w, h),
+        rect(landscapeArtSize(w, h), h - 73, MUTE_SIZE, MUTE_SIZE),
+        rect(landscapeArtSize(w, h), h - MUTE_SIZE, MUTE_SIZE, MUTE_SIZE),
+        rect(landscapeArtSize(w, h) + 45, h - 60, w - landscapeArtSize(w, h) - 60, VOLBAR_H),
+        rect(landscapeArtSize(w, h) + 45, h - 23, w - landscapeArtSize(w, h) - 60, VOLBAR_H),
+        rect(landscapeArtSize(w, h) + MUTE_SIZE, h - 73, w - landscapeArtSize(w, h) - MUTE_SIZE, MUTE_SIZE),
+        rect(landscapeArtSize(w, h) + MUTE_SIZE, h - MUTE_SIZE, w - landscapeArtSize(w, h) - MUTE_SIZE, MUTE_SIZE),
+
+        rect(0, BAR_H, w, h - BUTTON_H - BAR_H),
+
+        settingRow(w / 2, 0),
+        settingStep(w / 2, 0, -1),
+        settingStep(w / 2, 0, 1),
+        settingRow(w / 2, 1),
+        settingStep(w / 2, 1, -1),
+        settingStep(w / 2, 1, 1),
+        settingRow(w / 2, 2),
+        settingStep(w / 2, 2, -1),
+        settingStep(w / 2, 2, 1),
+        landscapeSettingAction(w, 0),
+        landscapeSettingAction(w, 1),
+        landscapeSettingAction(w, 2),
+
+        rect(0, (h - BUTTON_H - 40 < 265) ? (h - BUTTON_H - 40) : 265, w, 30)
+    };
+}
+
+constexpr Layout makeLayout(int w, int h)
+{
+    return (w > h) ? makeLandscapeLayout(w, h) : makePortraitLayout(w, h);
+}
+
+// Rotations 0 and 2 are portrait, 1 and 3 landscape
+constexpr Layout layoutFor(uint8_t rotation)
+{
+    return (rotation & 1) ? makeLayout(TFT_HEIGHT, TFT_WIDTH) : makeLayout(TFT_WIDTH, TFT_HEIGHT);
+}
+
+// Checks of the main screen, where the first matching touch target wins. A target hidden under another
+// one would never fire, and its icon would be drawn over the other. mute1 and mute2, and volZone1 and
+// volZone2, overlap on purpose and are listed in priority order, so they aren't checked against each other.
+constexpr bool overlaps(const Rect &a, const Rect &b)
+{
+    return a.w > 0 && a.h > 0 && b.w > 0 && b.h > 0
+        && a.x < b.right() && b.x < a.right() && a.y < b.bottom() && b.y < a.bottom();
+}
+
+// Clear of everything a stream command must not cover
+constexpr bool commandClear(const Layout &l, const Rect &c)
+{
+    return !overlaps(c, l.srcButton) && !overlaps(c, l.powerButton) && !overlaps(c, l.albumArt)
+        && !overlaps(c, l.metaText) && !overlaps(c, l.warnZone)
+        && !overlaps(c, l.mute1) && !overlaps(c, l.mute2) && !overlaps(c, l.volZone1) && !overlaps(c, l.volZone2);
+}
+
+constexpr bool selectTargetsClear(const Layout &l)
+{
+    return commandClear(l, l.likeButton) && commandClear(l, l.dislikeButton)
+        && commandClear(l, l.playPauseButton) && commandClear(l, l.skipButton)
+        && !overlaps(l.likeButton, l.dislikeButton) && !overlaps(l.likeButton, l.playPauseButton)
+        && !overlaps(l.likeButton, l.skipButton) && !overlaps(l.dislikeButton, l.playPauseButton)
+        && !overlaps(l.dislikeButton, l.skipButton) && !overlaps(l.playPauseButton, l.skipButton)
+        && !overlaps(l.albumArt, l.srcButton) && !overlaps(l.albumArt, l.powerButton)
+        && !overlaps(l.albumArt, l.mute1) && !overlaps(l.albumArt, l.mute2)
+        && !overlaps(l.albumArt, l.volZone1) && !overlaps(l.albumArt, l.volZone2);
+}
+
+// Both supported panels, upright (rotations 0 and 2) and on their side (1 and 3)
+static_assert(selectTargetsClear(makeLayout(240, 320)), "Main screen targets overlap on 240x320 panels in portrait");
+static_assert(selectTargetsClear(makeLayout(320, 240)), "Main screen targets overlap on 240x320 panels in landscape");
+static_assert(selectTargetsClear(makeLayout(320, 480)), "Main screen targets overlap on 320x480 panels in portrait");
+static_assert(selectTargetsClear(makeLayout(480, 320)), "Main screen targets overlap on 320x480 panels in landscape");
+
+#endif
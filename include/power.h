@@ -0,0 +1,46 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+// Backlight brightness and CPU speed. The backlight is driven with LEDC PWM so it can be dimmed. When the
+// panel isn't touched it dims, then turns off. While dimmed the refresh carries on at a slower rate, so a
+// touch brings back a screen that is already current. The CPU runs slower whenever nobody is looking.
+#define BACKLIGHT_CHANNEL 0
+#define BACKLIGHT_PWM_FREQ 5000 // In Hz, high enough not to flicker
+#define BACKLIGHT_PWM_BITS 8
+#define BACKLIGHT_FULL 255
+#define BACKLIGHT_DIM 40
+
+// Time without a touch before the backlight dims, and before the screen turns off (in milliseconds)
+#define IDLE_DIM_TIMEOUT 60000
+#define IDLE_OFF_TIMEOUT 600000
+
+// Timed refresh while dimmed (in milliseconds)
+#define IDLE_REFRESH_INTERVAL 10000
+
+// CPU speeds in MHz. 80 is the lowest that keeps the APB clock the SPI bus and Ethernet run from.
+#define CPU_FREQ_ACTIVE 240
+#define CPU_FREQ_IDLE 80
+
+enum IdleState : uint8_t {
+    IDLE_ACTIVE,
+    IDLE_DIMMED,
+    IDLE_OFF
+};
+
+// Take the backlight pin over from TFT_eSPI, at full brightness. Call after tft.init().
+void powerBegin();
+
+// Set the backlight and CPU speed for a state
+void idleSetState(IdleState state);
+
+IdleState idleState();
+
+// The panel was touched, start the timeouts again
+void idleTouch();
+
+// The state the timeouts call for. Never earlier than the current state, only a touch goes back.
+IdleState idleDue(uint32_t now);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Fonts whose glyph advances are cached
+#define TEXT_FONT_CACHE 4
+
+// Added where text is cut to fit
+#define TEXT_ELLIPSIS "..."
+
+// Marquee lines scroll text that doesn't fit. The text is rendered once into a strip twice the text wide
+// (plus the gap), and a window of it is pushed each frame.
+#define MARQUEE_GAP 48            // Pixels between the end of the text and its repeat
+#define MARQUEE_MAX_W 1600        // Wider text is cut with an ellipsis instead
+#define MARQUEE_FRAME_INTERVAL 50 // In milliseconds
+#define MARQUEE_STEP 2            // Pixels moved per frame
+#define MARQUEE_PAUSE 2000        // Time the start of the text is held still on each pass (in milliseconds)
+#define MARQUEE_LINES 2
+
+// Width in pixels of text drawn in a GFX font. Advances come from a per font cache, not the glyph table.
+int16_t textWidth(const GFXfont *font, const char *text);
+
+// The longest start of text that fits in maxWidth pixels, with an ellipsis if it had to be cut
+String textFit(const GFXfont *font, const String &text, int16_t maxWidth);
+
+// One line of text kept rendered in a 1 bit sprite. The text is only rendered again when it changes,
+// so redrawing an unchanged line is a single sprite push.
+struct TextLine {
+    TFT_eSprite *sprite;
+    bool spriteReady;    // false if there wasn't memory for the sprite, the line is then drawn straight to the display
+    const GFXfont *font;
+    int16_t w;
+    int16_t h;
+    uint16_t fg;
+    uint16_t bg;
+    String text;     // As given to textLineSet()
+    String shown;    // After fitting to the width
+    bool rendered;
+
+    // Marquee
+    bool marquee;    // Scroll text that doesn't fit, instead of cutting it
+    bool scrolling;  // The text is wider than the line and is being scrolled
+    int16_t textW;
+    int16_t offset;  // Start of the window pushed from the strip
+    uint32_t holdUntil;
+    int16_t x;       // Where the line was last drawn
+    int16_t y;
+    bool visible;    // Cleared by textLineHide() when something else covers the line
+};
+
+void textLineBegin(TextLine &line, TFT_eSPI *display, const GFXfont *font, int16_t w, int16_t h, uint16_t fg, uint16_t bg);
+
+// Change the text. Returns true if it changed, and the line will be rendered again at the next draw.
+bool textLineSet(TextLine &line, const String &text);
+
+// Draw the line centered in its box, at x, y on display
+void textLineDraw(TextLine &line, TFT_eSPI *display, int16_t x, int16_t y);
+
+// Give the line a new width, for a new layout. The text has to be set again.
+void textLineResize(TextLine &line, int16_t w);
+
+// Stop a marquee line drawing, until textLineDraw() is called again
+void textLineHide(TextLine &line);
+
+// Start the marquee timer. Frames are only pushed while spiLock can be taken.
+void marqueeBegin(SemaphoreHandle_t spiLock);
+
+// Scroll line when its text doesn't fit. Takes effect at the next textLineSet().
+void marqueeAdd(TextLine &line);
+
+#endif
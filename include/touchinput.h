@@ -0,0 +1,90 @@
+#ifndef TOUCHINPUT_H
+#define TOUCHINPUT_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// How often the touch controller is sampled (in milliseconds)
+#define TOUCH_SAMPLE_INTERVAL 10
+
+// Raw samples per reading, the median of these is used
+#define TOUCH_SAMPLES 5
+
+// Minimum pressure for a sample to count as a touch
+#define TOUCH_Z_THRESHOLD 350
+
+// Consecutive samples needed before a press or release is reported
+#define TOUCH_PRESS_SAMPLES 2
+#define TOUCH_RELEASE_SAMPLES 3
+
+// Distance in pixels the touch must move before a move event is reported
+#define TOUCH_MOVE_THRESHOLD 2
+
+enum TouchEventType : uint8_t {
+    TOUCH_PRESS,
+    TOUCH_MOVE,
+    TOUCH_RELEASE
+};
+
+struct TouchEvent {
+    TouchEventType type;
+    uint16_t x;
+    uint16_t y;
+    uint32_t time; // millis() when the sample was taken
+};
+
+// Distance in pixels a tap or long press may move before it becomes a drag or swipe
+#define GESTURE_SLOP 10
+
+// How long a touch must be held to count as a long press (in milliseconds)
+#define GESTURE_LONG_PRESS_TIME 600
+
+// A swipe covers at least this many pixels, mostly sideways, within the time limit (in milliseconds)
+#define GESTURE_SWIPE_DISTANCE 60
+#define GESTURE_SWIPE_TIME 400
+
+enum GestureType : uint8_t {
+    GESTURE_NONE,
+    GESTURE_TAP,
+    GESTURE_LONG_PRESS,
+    GESTURE_SWIPE_LEFT,
+    GESTURE_SWIPE_RIGHT,
+    GESTURE_DRAG,     // Vertical drag, dy is the movement since the last drag gesture
+    GESTURE_DRAG_END  // velocity is how fast the finger was moving when it lifted
+};
+
+struct Gesture {
+    GestureType type;
+    uint16_t x; // Where the touch started
+    uint16_t y;
+    int16_t dy;
+    float velocity; // Pixels per millisecond, positive is downwards
+};
+
+// Start the sampling task. The touch controller shares the SPI bus with the display,
+// so the task only samples while it holds spiLock.
+void touchBegin(TFT_eSPI *display, SemaphoreHandle_t spiLock);
+
+// Get the next touch event, returns false if there are none waiting
+bool touchGetEvent(TouchEvent *event);
+
+// Drop any events that haven't been handled yet
+void touchFlush();
+
+// Queue an event as if it had been sampled, for replaying recorded touches
+void touchInject(TouchEventType type, uint16_t x, uint16_t y);
+
+// Turn TFT_eSPI calibration data taken at one display rotation into the data for another, so rotating
+// the screen doesn't need the corners touched again
+void touchRotateCalibration(uint16_t *calData, uint8_t from, uint8_t to);
+
+// Feed a touch event to the gesture recognizer. Returns true if it completed a gesture.
+bool gestureFeed(const TouchEvent &event, Gesture *gesture);
+
+// Call regularly to pick up long presses, which complete while the finger is still down
+bool gesturePoll(uint32_t now, Gesture *gesture);
+
+// Forget the touch in progress, for when its coordinates no longer mean anything (the screen was rotated)
+void gestureCancel();
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <touchinput.h>
+
+// Record API responses and touch events to Serial as TRACE lines, so a session on a real panel can be
+// played back with tools/trace_replay.py. Turn on with -DRECORD_TRACE=1 in build_flags.
+// Printing the responses slows the panel down, so don't benchmark a recording build.
+#ifndef RECORD_TRACE
+#define RECORD_TRACE 0
+#endif
+
+// Print a STATS line every BENCH_REPORT_INTERVAL and take touches typed on Serial, for replaying a trace.
+// Turn on with -DBENCH_STATS=1 in build_flags.
+#ifndef BENCH_STATS
+#define BENCH_STATS 0
+#endif
+
+#define BENCH_REPORT_INTERVAL 5000 // In milliseconds
+#define TRACE_COMMAND_LEN 40       // Longest line accepted on Serial
+
+// Set up the lock that keeps lines from different tasks apart
+void traceBegin();
+
+// Record an API response. method is GET, PATCH, POST or ART (album art, the body isn't recorded).
+void traceResponse(const char *method, const String &request, int httpCode, const String &body);
+
+// Record a touch event
+void traceTouch(const TouchEvent &event);
+
+// Read touches sent by the replay tool, "touch <press|move|release> <x> <y>", and queue them as if sampled
+void traceReadSerial();
+
+// Count an HTTP request
+void benchRequest();
+
+// Count pixels sent to the display. Only the main drawing paths are counted, not small text and icons.
+void benchPixels(uint32_t pixels);
+
+// Count one pass of loop()
+void benchFrame(uint32_t micros);
+
+// Print and reset the counters once every BENCH_REPORT_INTERVAL
+void benchReport(uint32_t now);
+
+#endif
@@ -0,0 +1,75 @@
+#include <arena.h>
+#include <stdarg.h>
+
+Arena refreshArena = { "refresh", NULL, 0, 0, 0 };
+Arena screenArena = { "screen", NULL, 0, 0, 0 };
+
+static void arenaTake(Arena &arena, size_t size)
+{
+    arena.base = (uint8_t *)malloc(size);
+    arena.size = (arena.base != NULL) ? size : 0;
+    arena.used = 0;
+    arena.peak = 0;
+}
+
+void arenaBegin()
+{
+    arenaTake(refreshArena, REFRESH_ARENA_SIZE);
+    arenaTake(screenArena, SCREEN_ARENA_SIZE);
+}
+
+void *arenaAlloc(Arena &arena, size_t size)
+{
+    size_t start = (arena.used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (arena.base == NULL || start + size > arena.size)
+    {
+        Serial.printf("%s arena full, %u bytes from the heap\n", arena.name, (unsigned)size);
+        return NULL;
+    }
+    arena.used = start + size;
+    if (arena.used > arena.peak)
+    {
+        arena.peak = arena.used;
+    }
+    return arena.base + start;
+}
+
+void arenaReset(Arena &arena)
+{
+    arena.used = 0;
+}
+
+bool arenaOwns(const Arena &arena, const void *ptr)
+{
+    return arena.base != NULL && ptr >= arena.base && ptr < arena.base + arena.size;
+}
+
+const char *arenaPrintf(Arena &arena, const char *format, ...)
+{
+    // Format straight into the free space, then keep only what was written
+    size_t start = (arena.used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (arena.base == NULL || start >= arena.size)
+    {
+        Serial.printf("%s arena full, string dropped\n", arena.name);
+        return NULL;
+    }
+    char *buffer = (char *)arena.base + start;
+    size_t space = arena.size - start;
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, space, format, args);
+    va_end(args);
+
+    if (len < 0 || (size_t)len >= space)
+    {
+        Serial.printf("%s arena full, string dropped\n", arena.name);
+        return NULL;
+    }
+    arena.used = start + len + 1;
+    if (arena.used > arena.peak)
+    {
+        arena.peak = arena.used;
+    }
+    return buffer;
+}
@@ -0,0 +1,361 @@
+#include <artcache.h>
+#include <SPIFFS.h>
+#include <HTTPClient.h>
+#include <trace.h>
+
+struct ArtEntry {
+    uint32_t key;
+    uint16_t width;
+    uint32_t size;
+    uint32_t lastUsed; // Higher is more recent, 0 for images found at boot
+};
+
+struct ArtPrefetch {
+    uint32_t key;
+    uint16_t width;
+    char path[96];
+};
+
+// An image the prefetch task has been asked for
+struct ArtJob {
+    uint32_t key;
+    uint16_t width;
+    unsigned long at; // When it failed, for artFailed
+};
+
+static ArtEntry artEntries[ART_CACHE_ENTRIES];
+static uint8_t artEntryCount = 0;
+static uint32_t artUseCounter = 0;
+static SemaphoreHandle_t artLock = NULL; // Guards the index, which the prefetch task also uses
+static QueueHandle_t artQueue = NULL;
+static ArtJob artQueued[ART_PREFETCH_QUEUE + 1]; // Waiting in artQueue, or being fetched
+static uint8_t artQueuedCount = 0;
+static ArtJob artFailed[ART_PREFETCH_FAILED];    // Oldest is overwritten first
+static uint8_t artFailedNext = 0;
+static String (*artHostIP)() = NULL;
+static volatile unsigned long artLastActivity = 0;
+
+// FNV-1a
+uint32_t artKey(const String &url)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < url.length(); i++)
+    {
+        hash ^= (uint8_t)url[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static String artPath(uint32_t key, uint16_t width)
+{
+    char path[32];
+    snprintf(path, sizeof(path), ART_CACHE_DIR "%08x-%u.565", (unsigned int)key, (unsigned int)width);
+    return String(path);
+}
+
+// Index of an entry, or -1. Call with artLock held.
+static int findEntry(uint32_t key, uint16_t width)
+{
+    for (uint8_t i = 0; i < artEntryCount; i++)
+    {
+        if (artEntries[i].key == key && artEntries[i].width == width)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Index of a job in jobs, or -1. Call with artLock held.
+static int findJob(const ArtJob *jobs, uint8_t count, uint32_t key, uint16_t width)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (jobs[i].key == key && jobs[i].width == width)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Whether fetching the image failed within ART_PREFETCH_RETRY. Call with artLock held.
+static bool recentlyFailed(uint32_t key, uint16_t width)
+{
+    int i = findJob(artFailed, ART_PREFETCH_FAILED, key, width);
+    return i >= 0 && millis() - artFailed[i].at < ART_PREFETCH_RETRY;
+}
+
+// Call with artLock held
+static void removeEntry(int i)
+{
+    SPIFFS.remove(artPath(artEntries[i].key, artEntries[i].width));
+    artEntries[i] = artEntries[--artEntryCount];
+}
+
+// Drop least recently used images until size more bytes fit. Call with artLock held.
+static void makeRoom(size_t size)
+{
+    while (artEntryCount > 0)
+    {
+        uint32_t used = 0;
+        for (uint8_t i = 0; i < artEntryCount; i++)
+        {
+            used += artEntries[i].size;
+        }
+        if (artEntryCount < ART_CACHE_ENTRIES && used + size <= ART_CACHE_BUDGET)
+        {
+            return;
+        }
+
+        int oldest = 0;
+        for (uint8_t i = 1; i < artEntryCount; i++)
+        {
+            if (artEntries[i].lastUsed < artEntries[oldest].lastUsed)
+            {
+                oldest = i;
+            }
+        }
+        removeEntry(oldest);
+    }
+}
+
+bool artCacheHas(uint32_t key, uint16_t width)
+{
+    xSemaphoreTake(artLock, portMAX_DELAY);
+    bool found = (findEntry(key, width) >= 0);
+    xSemaphoreGive(artLock);
+    return found;
+}
+
+bool artCacheOpen(uint32_t key, uint16_t width, File *file, ArtHeader *header)
+{
+    xSemaphoreTake(artLock, portMAX_DELAY);
+    int i = findEntry(key, width);
+    if (i >= 0)
+    {
+        artEntries[i].lastUsed = ++artUseCounter;
+    }
+    xSemaphoreGive(artLock);
+    if (i < 0)
+    {
+        return false;
+    }
+
+    *file = SPIFFS.open(artPath(key, width), "r");
+    if (!*file)
+    {
+        return false;
+    }
+    if (file->read((uint8_t *)header, sizeof(ArtHeader)) != sizeof(ArtHeader) || header->width != width)
+    {
+        file->close();
+        return false;
+    }
+    return true;
+}
+
+File artCacheCreate(uint32_t key, const ArtHeader &header, size_t size)
+{
+    File file;
+    if (size > ART_CACHE_ENTRY_MAX)
+    {
+        return file;
+    }
+
+    xSemaphoreTake(artLock, portMAX_DELAY);
+    int i = findEntry(key, header.width);
+    if (i >= 0)
+    {
+        removeEntry(i);
+    }
+    makeRoom(size + sizeof(ArtHeader));
+    xSemaphoreGive(artLock);
+
+    // Written under a temporary name, so a reader never sees half an image
+    file = SPIFFS.open(artPath(key, header.width) + "~", "w");
+    if (file)
+    {
+        file.write((const uint8_t *)&header, sizeof(ArtHeader));
+    }
+    return file;
+}
+
+void artCacheFinish(uint32_t key, uint16_t width, File &file, bool ok)
+{
+    String path = artPath(key, width);
+    size_t size = file.size();
+    file.close();
+
+    if (!ok || !SPIFFS.rename(path + "~", path))
+    {
+        SPIFFS.remove(path + "~");
+        return;
+    }
+
+    xSemaphoreTake(artLock, portMAX_DELAY);
+    int i = findEntry(key, width);
+    if (i < 0 && artEntryCount < ART_CACHE_ENTRIES)
+    {
+        i = artEntryCount++;
+    }
+    if (i >= 0)
+    {
+        artEntries[i].key = key;
+        artEntries[i].width = width;
+        artEntries[i].size = size;
+        artEntries[i].lastUsed = ++artUseCounter;
+    }
+    xSemaphoreGive(artLock);
+}
+
+bool artPrefetch(uint32_t key, uint16_t width, const String &apiPath)
+{
+    if (artQueue == NULL || apiPath.length() >= sizeof(ArtPrefetch::path))
+    {
+        return false;
+    }
+
+    ArtPrefetch job;
+    job.key = key;
+    job.width = width;
+    strncpy(job.path, apiPath.c_str(), sizeof(job.path));
+
+    // Refreshes ask for the same image again and again, only queue it once and not again soon after it failed
+    bool queued = false;
+    xSemaphoreTake(artLock, portMAX_DELAY);
+    if (findEntry(key, width) < 0 && findJob(artQueued, artQueuedCount, key, width) < 0 && !recentlyFailed(key, width)
+        && artQueuedCount < ART_PREFETCH_QUEUE + 1 && xQueueSend(artQueue, &job, 0) == pdTRUE)
+    {
+        artQueued[artQueuedCount].key = key;
+        artQueued[artQueuedCount].width = width;
+        artQueuedCount++;
+        queued = true;
+    }
+    xSemaphoreGive(artLock);
+    return queued;
+}
+
+// The prefetch task is done with a job. Call with artLock held.
+static void finishJob(const ArtPrefetch &job, bool ok)
+{
+    int i = findJob(artQueued, artQueuedCount, job.key, job.width);
+    if (i >= 0)
+    {
+        artQueued[i] = artQueued[--artQueuedCount];
+    }
+    if (!ok)
+    {
+        ArtJob &failed = artFailed[artFailedNext];
+        artFailedNext = (artFailedNext + 1) % ART_PREFETCH_FAILED;
+        failed.key = job.key;
+        failed.width = job.width;
+        failed.at = millis();
+    }
+}
+
+void artActivity()
+{
+    artLastActivity = millis();
+}
+
+// Download one image into the cache. Returns false if it didn't get there.
+static bool prefetch(const ArtPrefetch &job, const String &host)
+{
+    HTTPClient http;
+    const char *headerKeys[] = { "Content-Type", "X-Image-Width", "X-Image-Height" };
+
+    http.setConnectTimeout(5000);
+    http.setTimeout(5000);
+    http.useHTTP10(true);
+    http.begin("http://" + host + "/api/" + job.path);
+    http.collectHeaders(headerKeys, 3);
+
+    int httpCode = http.GET();
+    benchRequest();
+    traceResponse("ART", String(job.path), httpCode, String());
+    String contentType = http.header("Content-Type");
+    int len = http.getSize();
+    bool ok = false;
+
+    if (httpCode == HTTP_CODE_OK && contentType.startsWith("application/x-rgb565") && len > 0
+        && http.header("X-Image-Width").toInt() == job.width)
+    {
+        ArtHeader header;
+        header.width = job.width;
+        header.height = http.header("X-Image-Height").toInt();
+        header.rle = contentType.startsWith("application/x-rgb565-rle") ? 1 : 0;
+
+        File file = artCacheCreate(job.key, header, len);
+        if (file)
+        {
+            int written = http.writeToStream(&file);
+            ok = (written == len);
+            artCacheFinish(job.key, job.width, file, ok);
+        }
+    }
+    http.end();
+    return ok;
+}
+
+static void prefetchLoop(void *parameter)
+{
+    ArtPrefetch job;
+    while (true)
+    {
+        xQueueReceive(artQueue, &job, portMAX_DELAY);
+
+        // Wait for the panel to be left alone, so prefetching doesn't compete with the user
+        String host;
+        while (millis() - artLastActivity < ART_PREFETCH_IDLE || (host = artHostIP()).length() == 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+        }
+
+        bool ok = true;
+        if (!artCacheHas(job.key, job.width))
+        {
+            Serial.println("Prefetching art: " + String(job.path));
+            ok = prefetch(job, host);
+        }
+        xSemaphoreTake(artLock, portMAX_DELAY);
+        finishJob(job, ok);
+        xSemaphoreGive(artLock);
+    }
+}
+
+void artCacheBegin(String (*hostIP)())
+{
+    artHostIP = hostIP;
+    artLock = xSemaphoreCreateMutex();
+    artQueue = xQueueCreate(ART_PREFETCH_QUEUE, sizeof(ArtPrefetch));
+
+    // Rebuild the index from the files on flash. SPIFFS has no real directories, so this lists everything.
+    File root = SPIFFS.open("/");
+    File file = root.openNextFile();
+    while (file)
+    {
+        String name = file.name();
+        unsigned int key;
+        unsigned int width;
+        if (name.startsWith(ART_CACHE_DIR) && name.endsWith("~"))
+        {
+            file.close();
+            SPIFFS.remove(name); // Left over from an interrupted download
+        }
+        else if (name.startsWith(ART_CACHE_DIR) && artEntryCount < ART_CACHE_ENTRIES
+            && sscanf(name.c_str(), ART_CACHE_DIR "%8x-%u.565", &key, &width) == 2)
+        {
+            ArtEntry &entry = artEntries[artEntryCount++];
+            entry.key = key;
+            entry.width = width;
+            entry.size = file.size();
+            entry.lastUsed = 0;
+        }
+        file = root.openNextFile();
+    }
+
+    // Lowest priority, on the network core
+    xTaskCreatePinnedToCore(prefetchLoop, "artprefetch", 4096, NULL, 0, NULL, 0);
+}
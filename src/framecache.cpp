@@ -0,0 +1,208 @@
+#include <framecache.h>
+
+// Encoded as 16 bit words. A word with the top bit set is a run, the low bits count copies of the pixel
+// in the next word. Otherwise the word counts pixels that follow as they are. Pixels are color565 values,
+// as readRect() gives them. Each part is encoded on its own, so runs never cross into the next part.
+#define FRAME_RUN 0x8000
+#define FRAME_COUNT_MAX 0x7FFF
+#define FRAME_PARTS 4 // Above, left of, right of and below the skipped area
+
+static uint16_t *frameWords = NULL;
+static size_t frameLen = 0;
+static Rect frameParts[FRAME_PARTS];
+static uint8_t framePartCount = 0;
+static uint8_t frameRotation = 0;
+
+struct FrameEncoder {
+    uint16_t *out;
+    size_t cap;
+    size_t used;
+    bool full;
+    uint16_t pixel;   // Run being counted
+    uint16_t count;
+    size_t literalAt; // Count word of the open literal group
+    uint16_t literals;
+};
+
+static void encodeWord(FrameEncoder &enc, uint16_t word)
+{
+    if (enc.used == enc.cap)
+    {
+        enc.full = true;
+        return;
+    }
+    enc.out[enc.used++] = word;
+}
+
+static void encodeLiteral(FrameEncoder &enc, uint16_t pixel)
+{
+    if (enc.literals == 0 || enc.literals == FRAME_COUNT_MAX)
+    {
+        enc.literalAt = enc.used;
+        enc.literals = 0;
+        encodeWord(enc, 0);
+    }
+    encodeWord(enc, pixel);
+    if (!enc.full)
+    {
+        enc.out[enc.literalAt] = ++enc.literals;
+    }
+}
+
+// Short runs cost less as literals
+static void encodeFlush(FrameEncoder &enc)
+{
+    if (enc.count >= 3)
+    {
+        enc.literals = 0;
+        encodeWord(enc, FRAME_RUN | enc.count);
+        encodeWord(enc, enc.pixel);
+    }
+    else
+    {
+        for (uint16_t i = 0; i < enc.count; i++)
+        {
+            encodeLiteral(enc, enc.pixel);
+        }
+    }
+    enc.count = 0;
+}
+
+static void encodePixel(FrameEncoder &enc, uint16_t pixel)
+{
+    if (enc.count > 0 && pixel == enc.pixel && enc.count < FRAME_COUNT_MAX)
+    {
+        enc.count++;
+        return;
+    }
+    encodeFlush(enc);
+    enc.pixel = pixel;
+    enc.count = 1;
+}
+
+static void addPart(int x, int y, int w, int h)
+{
+    if (w > 0 && h > 0)
+    {
+        frameParts[framePartCount++] = rect(x, y, w, h);
+    }
+}
+
+bool frameCacheSave(TFT_eSPI *display, const Rect &skip)
+{
+    frameCacheClear();
+#ifndef TFT_MISO
+    return false; // Write only panel
+#endif
+
+    int w = display->width();
+    int h = display->height();
+    if (skip.w > 0 && skip.h > 0)
+    {
+        addPart(0, 0, w, skip.y);
+        addPart(0, skip.y, skip.x, skip.h);
+        addPart(skip.right(), skip.y, w - skip.right(), skip.h);
+        addPart(0, skip.bottom(), w, h - skip.bottom());
+    }
+    else
+    {
+        addPart(0, 0, w, h);
+    }
+
+    uint16_t *rows = (uint16_t *)malloc(w * FRAME_READ_ROWS * sizeof(uint16_t));
+    FrameEncoder enc = {};
+    enc.out = (uint16_t *)malloc(FRAME_CACHE_BUDGET);
+    enc.cap = FRAME_CACHE_BUDGET / sizeof(uint16_t);
+    if (rows == NULL || enc.out == NULL)
+    {
+        Serial.println("Not enough memory to keep the screen.");
+        free(rows);
+        free(enc.out);
+        framePartCount = 0;
+        return false;
+    }
+
+    for (uint8_t i = 0; i < framePartCount && !enc.full; i++)
+    {
+        const Rect &part = frameParts[i];
+        for (int y = part.y; y < part.bottom() && !enc.full; y += FRAME_READ_ROWS)
+        {
+            int n = min(FRAME_READ_ROWS, part.bottom() - y);
+            display->readRect(part.x, y, part.w, n, rows);
+            for (int p = 0; p < part.w * n; p++)
+            {
+                encodePixel(enc, rows[p]);
+            }
+        }
+        encodeFlush(enc);
+        enc.literals = 0;
+    }
+    free(rows);
+
+    if (enc.full)
+    {
+        Serial.println("Screen too busy to keep.");
+        free(enc.out);
+        framePartCount = 0;
+        return false;
+    }
+
+    // Give back what the frame didn't use
+    frameLen = enc.used;
+    frameWords = (uint16_t *)realloc(enc.out, frameLen * sizeof(uint16_t));
+    if (frameWords == NULL)
+    {
+        frameWords = enc.out;
+    }
+    frameRotation = display->getRotation();
+    Serial.printf("Kept the screen in %u bytes\n", (unsigned)(frameLen * sizeof(uint16_t)));
+    return true;
+}
+
+bool frameCacheDraw(TFT_eSPI *display)
+{
+    if (frameWords == NULL || display->getRotation() != frameRotation)
+    {
+        return false;
+    }
+
+    // Literal pixels are color565 values, like the colors given to pushBlock()
+    bool swap = display->getSwapBytes();
+    display->setSwapBytes(true);
+    display->startWrite();
+
+    size_t i = 0;
+    for (uint8_t p = 0; p < framePartCount; p++)
+    {
+        const Rect &part = frameParts[p];
+        display->setAddrWindow(part.x, part.y, part.w, part.h);
+        uint32_t remaining = (uint32_t)part.w * part.h;
+        while (remaining > 0 && i < frameLen)
+        {
+            uint16_t word = frameWords[i++];
+            uint16_t count = word & FRAME_COUNT_MAX;
+            if (word & FRAME_RUN)
+            {
+                display->pushBlock(frameWords[i++], count);
+            }
+            else
+            {
+                display->pushPixels(&frameWords[i], count);
+                i += count;
+            }
+            remaining -= min((uint32_t)count, remaining);
+        }
+    }
+
+    display->endWrite();
+    display->setSwapBytes(swap);
+    return true;
+}
+
+void frameCacheClear()
+{
+    free(frameWords);
+    frameWords = NULL;
+    frameLen = 0;
+    framePartCount = 0;
+}
@@ -20,6 +20,15 @@
 #include <HTTPClient.h>
 #include <ESPmDNS.h>
 #include <Update.h>
+#include <Preferences.h>
+#include <touchinput.h>
+#include <artcache.h>
+#include <textlayout.h>
+#include <trace.h>
+#include <arena.h>
+#include <layout.h>
+#include <power.h>
+#include <framecache.h>
 
 static bool eth_connected = false;
 
@@ -27,6 +36,7 @@ static bool eth_connected = false;
 
 /* Debug options */
 #define DEBUGAPIREQ false // Debug API requests to Serial
+// RECORD_TRACE and BENCH_STATS (see trace.h) record a session for tools/trace_replay.py and report performance while replaying it
 
 #define DEBUG_WEBSERVER false // are you running the AmpliPi debug server on port 5000?
 
@@ -36,141 +46,96 @@ static bool eth_connected = false;
 // How quickly does the metadata refresh (in milliseconds)
 #define REFRESH_INTERVAL 2000
 
+// AmpliPis with /api/changes hold a request until something changes, so changes show straight away.
+// While that works the timed refresh only runs as a safety net.
+#define CHANGES_TIMEOUT 25             // Seconds the AmpliPi holds the request when nothing changes
+#define CHANGES_RETRY_INTERVAL 2000    // Wait after a failed request (in milliseconds)
+#define CHANGES_REFRESH_INTERVAL 30000 // Timed refresh while changes arrive (in milliseconds)
+
 // How long to show the selection screen before returning to the full-screen metadata screen (in milliseconds)
 #define SELECTSCREEN_TIMEOUT 10000
 
+// Minimum time between volume updates sent while dragging the volume bar (in milliseconds)
+#define VOL_SEND_INTERVAL 250
+
+// Mute and volume changes waiting for the command task to send them to the AmpliPi
+#define COMMAND_QUEUE_LEN 8
+
+// Album art is pushed to the display this many rows at a time as it downloads
+#define ART_BAND_ROWS 8
+
+// Before the album art downloads, a preview this many times smaller is drawn scaled up. Each preview row fills one band.
+#define ART_PREVIEW_SCALE ART_BAND_ROWS
+#define ART_PREVIEW_TIMEOUT 3000
+
+// Jpeg blocks in flight between the decoder task and the display. TJpg_Decoder blocks are at most 16x16 pixels.
+#define JPEG_BLOCKS 8
+#define JPEG_BLOCK_PIXELS (16 * 16)
+#define JPEG_DONE 0xFF
+#define JPEG_TIMEOUT 5000 // Give up on a stalled decode (in milliseconds)
+#define JPEG_PATH_LEN 32
+
+// Stream logos are prefetched at the width of the full screen art, which is where they show after picking a source
+#define ART_PREFETCH_W layout.albumArtFull.w
+
+// Minimum time between writes of the state snapshot to flash (in milliseconds)
+#define SNAPSHOT_INTERVAL 30000
+
 // Colors
 #define GREY 0x5AEB
 #define BLUE 0x9DFF
 
-// Source bar location
-#define SRCBAR_X 0
-#define SRCBAR_Y 0
-#define SRCBAR_W TFT_WIDTH
-#define SRCBAR_H 50
-
-#define SRCBUTTON_X (TFT_WIDTH - 40) // Top right side of screen
-#define SRCBUTTON_Y 0
-#define SRCBUTTON_W 50 // Oversize the button for easy selection
-#define SRCBUTTON_H 50 // Oversize the button for easy selection
-
-// Settings and About Screen Buttons
-#define LEFTBUTTON_X 0
-#define LEFTBUTTON_Y (TFT_HEIGHT - 50)
-#define LEFTBUTTON_W 130
-#define LEFTBUTTON_H 50
-
-#define CENTERBUTTON_X ((TFT_WIDTH / 2) - (44 / 2)) // Center
-#define CENTERBUTTON_Y (TFT_HEIGHT - 45)
-#define CENTERBUTTON_W 50
-#define CENTERBUTTON_H 50
-
-#define RIGHTBUTTON_W 130
-#define RIGHTBUTTON_H 50
-#define RIGHTBUTTON_X (TFT_WIDTH - RIGHTBUTTON_W)
-#define RIGHTBUTTON_Y (TFT_HEIGHT - 50)
-
-// Main area, normally where metadata is shown
-#define MAINZONE_X 0
-#define MAINZONE_Y 50
-#define MAINZONE_W TFT_WIDTH
-#define MAINZONE_H (TFT_HEIGHT - 50) // From below the source top bar to the bottom of the screen
-
-// Album art location on selection screen
-#define ALBUMART_X 60
-#define ALBUMART_Y 50
-#define ALBUMART_W 200
-#define ALBUMART_H ALBUMART_W
-
-// Album art location on metadata screen
-#define ALBUMART_FULL_X 0
-#define ALBUMART_FULL_Y 50
-#define ALBUMART_FULL_W TFT_WIDTH
-#define ALBUMART_FULL_H ALBUMART_W
-
-// Source Control Buttons
-#define PLAYPAUSEBUTTON_X (TFT_WIDTH - 36)
-#define PLAYPAUSEBUTTON_Y 64
-#define PLAYPAUSEBUTTON_W 36
-#define PLAYPAUSEBUTTON_H 36
-
-#define SKIPBUTTON_X (TFT_WIDTH - 36)
-#define SKIPBUTTON_Y 118
-#define SKIPBUTTON_W 36
-#define SKIPBUTTON_H 36
-
-#define LIKEBUTTON_X 0
-#define LIKEBUTTON_Y 64
-#define LIKEBUTTON_W 36
-#define LIKEBUTTON_H 36
-
-#define DISLIKEBUTTON_X 0
-#define DISLIKEBUTTON_Y 118
-#define DISLIKEBUTTON_W 36
-#define DISLIKEBUTTON_H 36
-
-// Metadata text location
-#define METATEXT_X 0
-#define METATEXT_Y (ALBUMART_Y + ALBUMART_H + 10) // Start Metadata text 10px below the album art
-#define METATEXT_W TFT_WIDTH
-#define METATEXT_H 90
-
-// Warning zone
-#define WARNZONE_X 0
-#define WARNZONE_Y (TFT_HEIGHT - 87) // Just above volume bar(s)
-#define WARNZONE_W TFT_WIDTH
-#define WARNZONE_H 14
-
-// Mute button location
-#define MUTE_X 0
-#define MUTE1_Y (TFT_HEIGHT - 73) // (upper)
-#define MUTE2_Y (TFT_HEIGHT - 50) // (lower)
-#define MUTE_W 50
-#define MUTE_H 50
-
-// Volume control bar position and size
-#define VOLBAR_X 45
-#define VOLBAR1_Y (TFT_HEIGHT - 60) // (upper)
-#define VOLBAR2_Y (TFT_HEIGHT - 23) // (lower)
-#define VOLBAR_W (TFT_WIDTH - 90) // 150 for 240w screen, 230 for 320ww screen
-#define VOLBAR_H 6
-
-// Volume control bar zone size
-#define VOLBARZONE_X 50
-#define VOLBARZONE1_Y (TFT_HEIGHT - 73) // (upper)
-#define VOLBARZONE2_Y (TFT_HEIGHT - 50) // (lower)
-#define VOLBARZONE_W (TFT_WIDTH - 50)
-#define VOLBARZONE_H 50
+// Where everything goes on screen, see layout.h. Rotations 0 and 2 use the portrait layout, 1 and 3 the
+// landscape one. layout is the one in use, applyLayout() switches it.
+constexpr Layout portraitLayout = layoutFor(0);
+constexpr Layout landscapeLayout = layoutFor(1);
+Layout layout = portraitLayout;
+
+// Widest art of either layout, for buffers that have to fit both
+constexpr int ART_MAX_W = (portraitLayout.albumArtFull.w > landscapeLayout.albumArtFull.w) ? portraitLayout.albumArtFull.w : landscapeLayout.albumArtFull.w;
+
+// Volume knob, a circle centered 2 pixels below the top of the bar
+#define VOLKNOB_R 8
+#define VOLKNOB_SIZE (VOLKNOB_R * 2 + 1)
+#define VOLKNOB_TOP (VOLKNOB_R - 2) // Rows of the knob above the bar
+
+// Maximum number of streams kept for the source selection list
+#define MAX_STREAM_LIST 40
+
+// Palette indexes used in the source list sprite
+#define LIST_BLACK 0
+#define LIST_BOX 1
+#define LIST_NAVY 2
+#define LIST_RED 3
+
+// Source list scrolling after a flick. Frame interval in milliseconds, friction is velocity lost per millisecond.
+#define SCROLL_FRAME_INTERVAL 33
+#define SCROLL_FRICTION 0.003
 
 #if TFT_WIDTH <= 240
     // Maximum length of the source name
     #define SRC_NAME_LEN 16
-
-    // Max length for title and artist metadata
-    #define TITLE_LEN 18
-    #define ARTIST_LEN 18
-
-    // Number of streams to show for stream selection
-    #define MAX_STREAMS 5
 #else
     // Maximum length of the source name
     #define SRC_NAME_LEN 25
-
-    // Max length for title and artist metadata
-    #define TITLE_LEN 24
-    #define ARTIST_LEN 25
-
-    // Number of streams to show for stream selection
-    #define MAX_STREAMS 7
 #endif
 
 /******************************/
 /* Configure system variables */
 /******************************/
 TFT_eSPI tft = TFT_eSPI(); // Invoke TFT display library
+SemaphoreHandle_t displayLock = NULL; // Display and touch controller share the SPI bus
+
+// Settings and the boot snapshot are kept in these NVS namespaces, each as one MessagePack record
+#define PREFS_CONFIG "config"
+#define PREFS_STATE "state"
+#define STORE_VERSION 2           // Version 1 wrote each setting to its own key
+#define RECORD_MAX_LEN 1536       // Largest record, the snapshot with long urls
 
-// This is the file name used to store the touch coordinate
-// calibration data. Cahnge the name to start a new calibration.
+// Touch calibration is 5 values, kept in the config namespace
+#define TOUCH_CAL_LEN (5 * sizeof(uint16_t))
+
+// Older versions kept the touch calibration in this file. It is moved into NVS at the first boot.
 #define CALIBRATION_FILE "/TouchCalData"
 
 // Set REPEAT_CAL to true instead of false to run calibration
@@ -180,11 +145,18 @@ TFT_eSPI tft = TFT_eSPI(); // Invoke TFT display library
 
 #define AMPLIPIHOST_LEN     64
 #define AMPLIPIZONE_LEN     6
+
+// Minimum time between mDNS lookups when the AmpliPi can't be reached (in milliseconds)
+#define RESOLVE_RETRY_INTERVAL 5000
 char amplipiHost [AMPLIPIHOST_LEN] = "amplipi.local"; // Default settings
 char amplipiZone1 [AMPLIPIZONE_LEN] = "0";
 char amplipiZone2 [AMPLIPIZONE_LEN] = "-1";
 char amplipiSource [AMPLIPIZONE_LEN] = "0";
-char configFileName[] = "/config.json";
+char configFileName[] = "/config.json"; // Old config and state files, only read to migrate them
+char stateFileName[] = "/state.json";
+Preferences prefs;
+TextLine songLine;
+TextLine artistLine;
 String hostname = "APCT"; // ETH MAC appended to this value
 String controllerVersionURI = "/static/controller_version.txt";
 String controllerBin = "/static/controller.bin";
@@ -193,8 +165,29 @@ String controllerBin = "/static/controller.bin";
 /*************************************/
 /* Configure globally used variables */
 /*************************************/
-String activeScreen = "select"; // Available screens: select, metadata, source, setting, about, off
-String amplipiHostIP = "";
+struct StreamListItem {
+    int id; // -1 is 'OFF', 0 is 'Local - RCA'
+    char name[SRC_NAME_LEN + 4]; // Room for the "..."
+};
+
+enum Screen : uint8_t {
+    SCREEN_SELECT,   // Main screen with source bar, album art, metadata and volume
+    SCREEN_METADATA, // Main screen, full width album art
+    SCREEN_SOURCE,   // Source selection
+    SCREEN_SETTING,
+    SCREEN_ABOUT,
+    SCREEN_ZONE,     // Zone details
+    SCREEN_OFF,
+    SCREEN_COUNT
+};
+
+Screen activeScreen = SCREEN_SELECT;
+char amplipiHostIP[AMPLIPIHOST_LEN] = ""; // Guarded by hostIPMux, use getAmpliPiHostIP()
+portMUX_TYPE hostIPMux = portMUX_INITIALIZER_UNLOCKED;
+char lastHostIP[AMPLIPIHOST_LEN] = ""; // Last address mDNS found, loaded from the config file
+volatile bool hostIPChanged = false;
+volatile unsigned long lastResolveAttempt = 0;
+TaskHandle_t resolverTask = NULL;
 String sourceName = "";
 String currentArtist = "";
 String currentSong = "";
@@ -209,8 +202,18 @@ int newAmplipiSource = 0;
 int newAmplipiZone1 = 0;
 int newAmplipiZone2 = 0;
 bool amplipiZone2Enabled = false;
-int currentSourceOffset = 0;
-int sourceIDs[9];
+StreamListItem streamList[MAX_STREAM_LIST]; // Source selection list, 'OFF' and 'Local - RCA' first
+int streamListCount = 0;
+int sourceScrollY = 0; // Pixels the source list is scrolled down
+int sourceScrollDrag = 0; // Drag movement not yet applied to the list
+bool tapStopsScroll = false; // A press that stopped a moving list isn't a tap on a row
+float sourceScrollVelocity = 0; // Pixels per millisecond while the list coasts after a flick
+unsigned long lastScrollFrame = 0;
+TFT_eSprite listSprite = TFT_eSprite(&tft); // Source list area, 4 bits per pixel
+bool listSpriteReady = false;
+bool showPrevButton = false;
+bool showNextButton = false;
+bool updateAvailable = false; // About screen is showing the Update button
 bool updateAlbumart = true;
 bool updateSource = false;
 bool updateMute1 = true;
@@ -222,7 +225,24 @@ float volPercent2 = 100;
 bool updateVol1 = true;
 bool updateVol2 = true;
 bool metadata_refresh = true;
-int screenRotation = 0; // Default value that can be changed in settings. 0 or 2
+bool refreshNow = false; // Refresh at the next pass of loop(), without waiting for the interval
+Screen frameScreen = SCREEN_SELECT; // Screen kept in the frame cache when the screen turned off
+bool frameArtLeftOut = false; // The art isn't in the kept frame, it's drawn from the art cache
+int screenRotation = 0; // Default value that can be changed in settings. 0 and 2 are portrait, 1 and 3 landscape
+int volDragZone = 0; // Zone whose volume bar is being dragged, 0 if none
+bool volUpdatePending = false;
+
+// What is on screen for each volume bar, 0 (upper) and 1 (lower), so a change only repaints what moved
+struct VolumeBar {
+    bool drawn;
+    bool muted;
+    int knobX;
+};
+VolumeBar volumeBars[2] = {{false, false, 0}, {false, false, 0}};
+TFT_eSprite knobSprite = TFT_eSprite(&tft); // The knob over the bar ends either side of it
+int knobSpriteColor = -1; // Color the knob sprite was rendered in, -1 if not rendered
+bool snapshotDirty = false; // Displayed state changed since the last snapshot was written
+bool networkScreenShown = false; // Welcome screen is up, waiting for the network on a first boot
 
 // Command statuses
 bool cmdPlaying = true;
@@ -233,143 +253,384 @@ bool cmdDislike = false;
 /***********************/
 /* Configure functions */
 /***********************/
-String findMDNS(String mDnsHost) {
-    // If the input ends in '.local', we have to remove it for mDNS resolution
+// Strip '.local' from a host name, mDNS queries are made with the bare name
+String mdnsQueryName(String mDnsHost) {
     int len = mDnsHost.length();
     if (mDnsHost.substring((len - 6)) == ".local") {
         mDnsHost.replace(".local", "");
     }
+    return mDnsHost;
+}
 
-    Serial.println("Finding the mDNS details...");
-    Serial.println(mDnsHost);
+// Thread safe access to the resolved AmpliPi address. The resolver task swaps it in the background.
+String getAmpliPiHostIP() {
+    char hostIP[AMPLIPIHOST_LEN];
+    portENTER_CRITICAL(&hostIPMux);
+    strncpy(hostIP, amplipiHostIP, sizeof(hostIP));
+    portEXIT_CRITICAL(&hostIPMux);
+    hostIP[sizeof(hostIP) - 1] = '\0';
+    return String(hostIP);
+}
 
-    //if (!MDNS.begin(chipid_char)) {
-    if (!MDNS.begin(hostname.c_str())) {
-        Serial.println("Error setting up MDNS responder.");
-    } else {
-        Serial.println("Finished initializing the MDNS client.");
-        Serial.print("Hostname: ");
-        Serial.println(hostname);
+void setAmpliPiHostIP(const char *hostIP) {
+    portENTER_CRITICAL(&hostIPMux);
+    strncpy(amplipiHostIP, hostIP, sizeof(amplipiHostIP));
+    amplipiHostIP[sizeof(amplipiHostIP) - 1] = '\0';
+    portEXIT_CRITICAL(&hostIPMux);
+}
+
+bool hostIPKnown() {
+    return getAmpliPiHostIP().length() > 0;
+}
+
+// Ask the resolver task to look up the AmpliPi again, for example after a failed API request
+void requestResolve() {
+    if (resolverTask == NULL || validateIPv4(amplipiHost)) {
+        return;
+    }
+    if (lastResolveAttempt != 0 && millis() - lastResolveAttempt < RESOLVE_RETRY_INTERVAL) {
+        return; // Don't hammer mDNS while the AmpliPi is unreachable
+    }
+    xTaskNotifyGive(resolverTask);
+}
+
+// Background task that resolves the AmpliPi via mDNS, so setup() and loop() never block on it
+void resolverLoop(void *parameter) {
+    String mDnsHost = mdnsQueryName(String(amplipiHost));
+    bool mdnsStarted = false;
+
+    for (;;) {
+        // Wait until someone asks for a resolve
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (!eth_connected) {
+            vTaskDelay(pdMS_TO_TICKS(250));
+        }
+
+        if (!mdnsStarted) {
+            if (!MDNS.begin(hostname.c_str())) {
+                Serial.println("Error setting up MDNS responder.");
+            } else {
+                Serial.println("Finished initializing the MDNS client.");
+                Serial.print("Hostname: ");
+                Serial.println(hostname);
+                mdnsStarted = true;
+            }
+        }
+
+        Serial.print("Resolving mDNS: ");
+        Serial.println(mDnsHost);
+
+        // Keep trying until we find it, backing off so we don't flood the network
+        uint32_t retryDelay = 250;
+        IPAddress serverIp = MDNS.queryHost(mDnsHost);
+        while (serverIp == IPAddress(0, 0, 0, 0)) {
+            lastResolveAttempt = millis();
+            Serial.println("Trying again to resolve mDNS");
+            vTaskDelay(pdMS_TO_TICKS(retryDelay));
+            if (retryDelay < RESOLVE_RETRY_INTERVAL) { retryDelay *= 2; }
+            serverIp = MDNS.queryHost(mDnsHost);
+        }
+        lastResolveAttempt = millis();
+
+        String newHostIP = serverIp.toString();
+#if DEBUG_WEBSERVER
+        newHostIP += ":5000";
+#endif
+        if (newHostIP != getAmpliPiHostIP()) {
+            Serial.print("IP address of server: ");
+            Serial.println(newHostIP);
+            setAmpliPiHostIP(newHostIP.c_str());
+            hostIPChanged = true; // loop() persists it, so the next boot can start with it
+        }
+    }
+}
+
+// Settings, touch calibration and the boot snapshot live in NVS through Preferences. The settings and
+// the snapshot are each one record under one key. NVS replaces a value as a whole, so a power cut leaves
+// the old record or the new one, never fields from both.
+bool putRecord(const char *space, const char *key, JsonDocument &doc)
+{
+    doc["v"] = STORE_VERSION;
+    uint8_t buffer[RECORD_MAX_LEN];
+    if (measureMsgPack(doc) > sizeof(buffer)) {
+        Serial.printf("%s record too big to save\n", key);
+        return false;
     }
+    size_t len = serializeMsgPack(doc, buffer, sizeof(buffer));
+
+    prefs.begin(space, false);
+    bool ok = (prefs.putBytes(key, buffer, len) == len);
+    prefs.end();
+    return ok;
+}
 
-    Serial.println("mDNS responder started");
-    IPAddress serverIp = MDNS.queryHost(mDnsHost);
-    while (serverIp.toString() == "0.0.0.0") {
-        Serial.println("Trying again to resolve mDNS");
-        tft.fillRect(0, 280, 240, 40, TFT_BLACK); // Clear area first
-        tft.drawString("Looking for AmpliPi at: ", 120, 280, GFXFF); // Center Middle
-        tft.drawString(mDnsHost, 120, 300, GFXFF); // Center Middle
-        delay(250);
-        serverIp = MDNS.queryHost(mDnsHost);
+// Read a record saved by putRecord(). False if there isn't one of this version.
+bool getRecord(const char *space, const char *key, JsonDocument &doc)
+{
+    uint8_t buffer[RECORD_MAX_LEN];
+    prefs.begin(space, true);
+    size_t len = prefs.getBytesLength(key);
+    bool ok = (len > 0 && len <= sizeof(buffer) && prefs.getBytes(key, buffer, len) == len);
+    prefs.end();
+
+    // Parsed from a const buffer, so the strings are copied out of it
+    return ok && !deserializeMsgPack(doc, (const uint8_t *)buffer, len) && doc["v"].as<int>() == STORE_VERSION;
+}
+
+// Copy a string from a record, keeping the current value if the record doesn't have it
+void recordString(JsonDocument &doc, const char *key, char *value, size_t size)
+{
+    const char *stored = doc[key];
+    if (stored != NULL) {
+        strncpy(value, stored, size - 1);
+        value[size - 1] = '\0';
     }
-    Serial.print("IP address of server: ");
-    Serial.println(serverIp.toString());
-    Serial.println("Finished finding the mDNS details...");
-    return serverIp.toString();
 }
 
-bool saveFileFSConfigFile()
+bool saveConfig()
 {
     Serial.println(F("Saving config"));
 
-    DynamicJsonDocument json(1024);
+    DynamicJsonDocument doc(512);
+    doc["host"] = amplipiHost;
+    doc["zone1"] = amplipiZone1;
+    doc["zone2"] = amplipiZone2;
+    doc["source"] = amplipiSource;
+    doc["rotation"] = screenRotation;
+    doc["hostIP"] = lastHostIP;
+    return putRecord(PREFS_CONFIG, "settings", doc);
+}
 
-    json["amplipiHost"]  = amplipiHost;
-    json["amplipiZone1"] = amplipiZone1;
-    json["amplipiZone2"] = amplipiZone2;
-    json["amplipiSource"] = amplipiSource;
-    json["screenRotation"] = tft.getRotation();
+// The resolved address is part of the config record, so the whole record is written
+void saveHostIP()
+{
+    saveConfig();
+}
 
-    File configFile = SPIFFS.open(configFileName, "w");
+bool loadTouchCalibration(uint16_t *calData)
+{
+    prefs.begin(PREFS_CONFIG, true);
+    bool ok = (prefs.getBytes("touchCal", calData, TOUCH_CAL_LEN) == TOUCH_CAL_LEN);
+    prefs.end();
+    return ok;
+}
 
-    if (!configFile)
-    {
-        Serial.println(F("Failed to open config file for writing"));
+void saveTouchCalibration(const uint16_t *calData)
+{
+    prefs.begin(PREFS_CONFIG, false);
+    prefs.putBytes("touchCal", calData, TOUCH_CAL_LEN);
+    prefs.end();
+}
 
+// Forget the calibration, so it runs again at the next boot
+void clearTouchCalibration()
+{
+    prefs.begin(PREFS_CONFIG, false);
+    prefs.remove("touchCal");
+    prefs.end();
+}
+
+// Save what is currently displayed, so the next boot can show it right away
+bool saveStateSnapshot()
+{
+    DynamicJsonDocument doc(RECORD_MAX_LEN);
+    doc["streamID"] = currentStreamID;
+    doc["streamName"] = currentStreamName;
+    doc["streamType"] = currentStreamType;
+    doc["artist"] = currentArtist;
+    doc["song"] = currentSong;
+    doc["status"] = currentStatus;
+    doc["albumArt"] = currentAlbumArt; // Image itself is already kept in /albumart.jpg or the art cache
+    doc["vol1"] = volPercent1;
+    doc["vol2"] = volPercent2;
+    doc["mute1"] = muteZone1;
+    doc["mute2"] = muteZone2;
+
+    // Not retried when it doesn't fit, the next change tries again
+    snapshotDirty = false;
+    return putRecord(PREFS_STATE, "snapshot", doc);
+}
+
+bool loadStateSnapshot()
+{
+    DynamicJsonDocument doc(RECORD_MAX_LEN + 512);
+    if (!getRecord(PREFS_STATE, "snapshot", doc)) {
         return false;
     }
+    currentStreamID = doc["streamID"].as<String>();
+    currentStreamName = doc["streamName"].as<String>();
+    currentStreamType = doc["streamType"].as<String>();
+    currentArtist = doc["artist"].as<String>();
+    currentSong = doc["song"].as<String>();
+    currentStatus = doc["status"].as<String>();
+    currentAlbumArt = doc["albumArt"].as<String>();
+    volPercent1 = doc["vol1"] | 100.0;
+    volPercent2 = doc["vol2"] | 100.0;
+    muteZone1 = doc["mute1"];
+    muteZone2 = doc["mute2"];
+    Serial.println(F("Loaded state snapshot"));
+    return true;
+}
 
-    serializeJsonPretty(json, Serial);
-    // Write data to file and close it
-    serializeJson(json, configFile);
+// Version 1 kept each setting and snapshot field under its own key. Read them into the globals and drop
+// the keys, the records replace them. Returns false if there was no version 1 config.
+bool migrateConfigKeys()
+{
+    prefs.begin(PREFS_CONFIG, false);
+    bool found = (prefs.getUChar("version", 0) == 1);
+    if (found)
+    {
+        Serial.println(F("Migrating config keys"));
+        prefs.getString("host", amplipiHost, sizeof(amplipiHost));
+        prefs.getString("zone1", amplipiZone1, sizeof(amplipiZone1));
+        prefs.getString("zone2", amplipiZone2, sizeof(amplipiZone2));
+        prefs.getString("source", amplipiSource, sizeof(amplipiSource));
+        prefs.getString("hostIP", lastHostIP, sizeof(lastHostIP));
+        screenRotation = prefs.getUChar("rotation", screenRotation);
+    }
+    prefs.end();
+    if (!found) {
+        return false;
+    }
 
-    configFile.close();
-    //end save
+    prefs.begin(PREFS_STATE, false);
+    bool snapshot = prefs.getBool("valid", false);
+    if (snapshot)
+    {
+        currentStreamID = prefs.getString("streamID");
+        currentStreamName = prefs.getString("streamName");
+        currentStreamType = prefs.getString("streamType");
+        currentArtist = prefs.getString("artist");
+        currentSong = prefs.getString("song");
+        currentStatus = prefs.getString("status");
+        currentAlbumArt = prefs.getString("albumArt");
+        volPercent1 = prefs.getFloat("vol1", 100.0);
+        volPercent2 = prefs.getFloat("vol2", 100.0);
+        muteZone1 = prefs.getBool("mute1");
+        muteZone2 = prefs.getBool("mute2");
+    }
+    prefs.end();
 
+    // The config record is written last, as until it exists the next boot migrates again
+    if (snapshot) {
+        saveStateSnapshot();
+    }
+    saveConfig();
+
+    const char *configKeys[] = { "host", "zone1", "zone2", "source", "hostIP", "rotation", "version" };
+    prefs.begin(PREFS_CONFIG, false);
+    for (const char *key : configKeys) { prefs.remove(key); }
+    prefs.end();
+    prefs.begin(PREFS_STATE, false);
+    const char *stateKeys[] = { "streamID", "streamName", "streamType", "artist", "song", "status", "albumArt",
+        "vol1", "vol2", "mute1", "mute2", "valid" };
+    for (const char *key : stateKeys) { prefs.remove(key); }
+    prefs.end();
     return true;
 }
 
-bool loadFileFSConfigFile()
+// Move settings from the files older versions kept on SPIFFS into NVS. Runs once.
+void migrateConfigFiles()
 {
-    //read configuration from FS json
-    Serial.println(F("Mounting FS..."));
-
-    if (SPIFFS.begin())
+    if (SPIFFS.exists(configFileName))
     {
-        Serial.println(F("Mounted file system"));
-        if (SPIFFS.exists(configFileName))
+        Serial.println(F("Migrating config file"));
+        File configFile = SPIFFS.open(configFileName, "r");
+        DynamicJsonDocument json(1024);
+        if (configFile && !deserializeJson(json, configFile))
         {
-            //file exists, reading and loading
-            Serial.println(F("Reading config file"));
-            File configFile = SPIFFS.open(configFileName, "r");
-
-            if (configFile)
-            {
-                Serial.print(F("Opened config file, size = "));
-                size_t configFileSize = configFile.size();
-                Serial.println(configFileSize);
-
-                // Allocate a buffer to store contents of the file.
-                std::unique_ptr<char[]> buf(new char[configFileSize + 1]);
+            if (json["amplipiHost"])
+                strncpy(amplipiHost,  json["amplipiHost"],  sizeof(amplipiHost));
 
-                configFile.readBytes(buf.get(), configFileSize);
+            if (json["amplipiZone1"])
+                strncpy(amplipiZone1, json["amplipiZone1"], sizeof(amplipiZone1));
 
-                Serial.print(F("\nJSON parseObject() result : "));
+            if (json["amplipiZone2"])
+                strncpy(amplipiZone2, json["amplipiZone2"], sizeof(amplipiZone2));
 
-                DynamicJsonDocument json(1024);
-                auto deserializeError = deserializeJson(json, buf.get(), configFileSize);
+            if (json["amplipiSource"])
+                strncpy(amplipiSource, json["amplipiSource"], sizeof(amplipiSource));
 
-                if ( deserializeError )
-                {
-                    Serial.println(F("failed"));
-                    return false;
-                }
-                else
-                {
-                    Serial.println(F("OK"));
-
-                    if (json["amplipiHost"])
-                        strncpy(amplipiHost,  json["amplipiHost"],  sizeof(amplipiHost));
-                    
-                    if (json["amplipiZone1"])
-                        strncpy(amplipiZone1, json["amplipiZone1"], sizeof(amplipiZone1));
-            
-                    if (json["amplipiZone2"])
-                        strncpy(amplipiZone2, json["amplipiZone2"], sizeof(amplipiZone2));
-            
-                    if (json["amplipiSource"])
-                        strncpy(amplipiSource, json["amplipiSource"], sizeof(amplipiSource));
-            
-                    if (json["screenRotation"])
-                        screenRotation = json["screenRotation"];
-                }
+            if (json["screenRotation"])
+                screenRotation = json["screenRotation"];
 
-                //serializeJson(json, Serial);
-                serializeJsonPretty(json, Serial);
+            if (json["amplipiHostIP"])
+                strncpy(lastHostIP, json["amplipiHostIP"], sizeof(lastHostIP));
+        }
+        configFile.close();
+    }
 
-                configFile.close();
-            }
+    if (SPIFFS.exists(CALIBRATION_FILE))
+    {
+        uint16_t calData[5];
+        File f = SPIFFS.open(CALIBRATION_FILE, "r");
+        if (f && f.readBytes((char *)calData, TOUCH_CAL_LEN) == TOUCH_CAL_LEN)
+        {
+            saveTouchCalibration(calData);
         }
-        else {
-            // Config file doesn't exist. Create config file with default settings
-            saveFileFSConfigFile();
+        f.close();
+    }
+
+    if (SPIFFS.exists(stateFileName))
+    {
+        File stateFile = SPIFFS.open(stateFileName, "r");
+        DynamicJsonDocument json(1024);
+        if (stateFile && !deserializeJson(json, stateFile))
+        {
+            currentStreamID = json["streamID"].as<String>();
+            currentStreamName = json["streamName"].as<String>();
+            currentStreamType = json["streamType"].as<String>();
+            currentArtist = json["artist"].as<String>();
+            currentSong = json["song"].as<String>();
+            currentStatus = json["status"].as<String>();
+            currentAlbumArt = json["albumArt"].as<String>();
+            volPercent1 = json["vol1"] | 100.0;
+            volPercent2 = json["vol2"] | 100.0;
+            muteZone1 = json["mute1"];
+            muteZone2 = json["mute2"];
+            saveStateSnapshot();
         }
+        stateFile.close();
     }
-    else
+
+    // The config record marks the migration as done, so it's written once everything else is in NVS.
+    // A power cut before this runs the migration again at the next boot, from files that are still there.
+    saveConfig();
+
+    SPIFFS.remove(configFileName);
+    SPIFFS.remove(CALIBRATION_FILE);
+    SPIFFS.remove(stateFileName);
+}
+
+bool loadConfig()
+{
+    Serial.println(F("Mounting FS..."));
+
+    if (!SPIFFS.begin())
     {
         Serial.println(F("failed to mount FS"));
-        return false;
     }
+
+    DynamicJsonDocument doc(1024);
+    if (!getRecord(PREFS_CONFIG, "settings", doc))
+    {
+        // No config record yet. Take what version 1 kept in NVS, or what the old files have (or the defaults).
+        if (!migrateConfigKeys()) {
+            migrateConfigFiles();
+        }
+        return true;
+    }
+
+    recordString(doc, "host", amplipiHost, sizeof(amplipiHost));
+    recordString(doc, "zone1", amplipiZone1, sizeof(amplipiZone1));
+    recordString(doc, "zone2", amplipiZone2, sizeof(amplipiZone2));
+    recordString(doc, "source", amplipiSource, sizeof(amplipiSource));
+    recordString(doc, "hostIP", lastHostIP, sizeof(lastHostIP));
+    screenRotation = doc["rotation"] | screenRotation;
+
+    Serial.println("Config: host " + String(amplipiHost) + ", zones " + String(amplipiZone1) + "/" + String(amplipiZone2)
+        + ", source " + String(amplipiSource) + ", rotation " + String(screenRotation));
     return true;
 }
 
@@ -379,24 +640,27 @@ void getAmpliPiIP()
     // Check to see if IP or DNS
     if (validateIPv4(amplipiHost)) {
         // Is an IP
-        amplipiHostIP = String(amplipiHost);
+        setAmpliPiHostIP(amplipiHost);
         Serial.print("amplipiHostIP (IP): ");
-        Serial.println(amplipiHostIP);
+        Serial.println(amplipiHost);
+        return;
     }
-    else {
-        // Not an IP, look up via MDNS:
-        amplipiHostIP = findMDNS(String(amplipiHost));
-#if DEBUG_WEBSERVER
-        amplipiHostIP += ":5000";
-#endif
-        //Serial.print("amplipiHostIP (mDNS): ");
-        //Serial.println(amplipiHostIP);
+
+    // Not an IP. Start with the last address we found so startup doesn't wait on mDNS,
+    // and look it up again in the background in case the AmpliPi has moved.
+    if (strlen(lastHostIP) > 0) {
+        setAmpliPiHostIP(lastHostIP);
+        Serial.print("amplipiHostIP (cached): ");
+        Serial.println(lastHostIP);
     }
+
+    xTaskCreatePinnedToCore(resolverLoop, "resolver", 4096, NULL, 1, &resolverTask, 0);
+    xTaskNotifyGive(resolverTask);
 }
 
 
 // Function to handle touchscreen calibration. Calibration only runs once, unless 
-//  TouchCalData file is removed or REPEAT_CAL is set to true
+//  the stored calibration is cleared or REPEAT_CAL is set to true
 void touch_calibrate()
 {
     uint16_t calData[5];
@@ -410,24 +674,15 @@ void touch_calibrate()
         SPIFFS.begin();
     }
 
-    // check if calibration file exists and size is correct
-    if (SPIFFS.exists(CALIBRATION_FILE))
+    // check if calibration data exists and size is correct
+    if (REPEAT_CAL)
     {
-        if (REPEAT_CAL)
-        {
-            // Delete if we want to re-calibrate
-            SPIFFS.remove(CALIBRATION_FILE);
-        }
-        else
-        {
-            File f = SPIFFS.open(CALIBRATION_FILE, "r");
-            if (f)
-            {
-                if (f.readBytes((char *)calData, 14) == 14)
-                    calDataOK = 1;
-                f.close();
-            }
-        }
+        // Delete if we want to re-calibrate
+        clearTouchCalibration();
+    }
+    else if (loadTouchCalibration(calData))
+    {
+        calDataOK = 1;
     }
 
     if (calDataOK && !REPEAT_CAL)
@@ -441,6 +696,7 @@ void touch_calibrate()
         // data not valid so recalibrate
         Serial.println("Entering touch screen calibration...");
         tft.fillScreen(TFT_BLACK);
+        textLineHide(songLine);
         tft.setCursor(20, 20);
         tft.setFreeFont(FSS12);
         tft.setTextColor(TFT_WHITE, TFT_BLACK);
@@ -464,12 +720,7 @@ void touch_calibrate()
         tft.println("Calibration complete!");
 
         // store data
-        File f = SPIFFS.open(CALIBRATION_FILE, "w");
-        if (f)
-        {
-            f.write((const unsigned char *)calData, 14);
-            f.close();
-        }
+        saveTouchCalibration(calData);
     }
 }
 
@@ -517,10 +768,32 @@ void WiFiEvent(WiFiEvent_t event)
 }
 
 
+// loop() owns the display, but hands it to the touch task while it waits on the network
+void acquireDisplay()
+{
+    xSemaphoreTake(displayLock, portMAX_DELAY);
+}
+
+void releaseDisplay()
+{
+    xSemaphoreGive(displayLock);
+}
+
+
+// The volume bars have been painted over, the next drawVolume() has to draw them in full
+void forgetVolumeBars()
+{
+    volumeBars[0].drawn = false;
+    volumeBars[1].drawn = false;
+}
+
 // Clear the main area of the screen. Generally metadata is shown here, but also source select and settings
 void clearMainArea()
 {
-    tft.fillRect(MAINZONE_X, MAINZONE_Y, MAINZONE_W, MAINZONE_H, TFT_BLACK); // Clear metadata area
+    tft.fillRect(layout.mainZone.x, layout.mainZone.y, layout.mainZone.w, layout.mainZone.h, TFT_BLACK); // Clear metadata area
+    benchPixels(layout.mainZone.w * layout.mainZone.h);
+    textLineHide(songLine); // Stop the marquee until the metadata is drawn again
+    forgetVolumeBars();
 }
 
 
@@ -528,13 +801,13 @@ void clearMainArea()
 void drawWarning(String message)
 {
     if (!inWarning) {
-        tft.fillRect(WARNZONE_X, WARNZONE_Y, WARNZONE_W, WARNZONE_H, TFT_BLACK); // Clear warning area
+        tft.fillRect(layout.warnZone.x, layout.warnZone.y, layout.warnZone.w, layout.warnZone.h, TFT_BLACK); // Clear warning area
         Serial.print("Warning: ");
         Serial.println(message);
         tft.setTextColor(TFT_RED, TFT_BLACK);
         tft.setFreeFont(FSS9);
         tft.setTextDatum(TL_DATUM);
-        tft.drawString(message, (WARNZONE_X + 5), WARNZONE_Y);
+        tft.drawString(message, (layout.warnZone.x + 5), layout.warnZone.y);
         tft.setTextColor(TFT_WHITE, TFT_BLACK);
         tft.setFreeFont(FSS12);
         inWarning = true;
@@ -544,7 +817,7 @@ void drawWarning(String message)
 void clearWarning()
 {
     Serial.println("Cleared warning.");
-    tft.fillRect(WARNZONE_X, WARNZONE_Y, WARNZONE_W, WARNZONE_H, TFT_BLACK); // Clear warning area
+    tft.fillRect(layout.warnZone.x, layout.warnZone.y, layout.warnZone.w, layout.warnZone.h, TFT_BLACK); // Clear warning area
     inWarning = false;
 }
 
@@ -611,6 +884,7 @@ void drawBmp(const char *filename, int16_t x, int16_t y)
                 // Push the pixel row to screen, pushImage will crop the line if needed
                 // y is decremented as the BMP image is drawn bottom up
                 tft.pushImage(x, y--, w, 1, (uint16_t *)lineBuffer);
+                benchPixels(w);
             }
             tft.setSwapBytes(oldSwapBytes);
             Serial.print("Loaded in ");
@@ -633,6 +907,7 @@ bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
 
   // This function will clip the image block rendering automatically at the TFT boundaries
   tft.pushImage(x, y, w, h, bitmap);
+  benchPixels(w * h);
 
   // This might work instead if you adapt the sketch to use the Adafruit_GFX library
   // tft.drawRGBBitmap(x, y, bitmap, w, h);
@@ -642,24 +917,257 @@ bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
 }
 
 
+// Jpegs are decoded on core 0 while loop() pushes the finished blocks to the display, so decoding and the
+// SPI transfer overlap. Blocks are passed through a ring of slots: the decoder fills free slots, loop()
+// pushes ready ones with DMA and hands each slot back once its transfer is done.
+struct JpegBlock {
+    int16_t x;
+    int16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t pixels[JPEG_BLOCK_PIXELS];
+};
+
+JpegBlock jpegBlocks[JPEG_BLOCKS];
+QueueHandle_t jpegFree = NULL;  // Slot numbers the decoder may fill
+QueueHandle_t jpegReady = NULL; // Slot numbers ready to push, JPEG_DONE when the image is finished
+TaskHandle_t jpegTask = NULL;
+volatile bool jpegBusy = false;  // The decoder has a job, until loop() takes its JPEG_DONE
+volatile bool jpegAbort = false; // drawJpeg() gave up on the job, the decoder stops at its next block
+char jpegFile[JPEG_PATH_LEN];   // Only written while the decoder is idle
+int jpegX = 0;
+int jpegY = 0;
+bool dmaReady = false;
+
+// Decoder callback, runs on the jpeg task. Waits for a free slot, so the decoder can only get JPEG_BLOCKS ahead.
+bool jpegQueueBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
+{
+    // Stop further decoding as image is running off bottom of screen
+    if (jpegAbort || y >= tft.height() || (w * h) > JPEG_BLOCK_PIXELS) return 0;
+
+    uint8_t slot;
+    if (xQueueReceive(jpegFree, &slot, pdMS_TO_TICKS(JPEG_TIMEOUT)) != pdTRUE) return 0;
+    if (jpegAbort) {
+        xQueueSend(jpegFree, &slot, 0);
+        return 0;
+    }
+
+    JpegBlock &block = jpegBlocks[slot];
+    block.x = x;
+    block.y = y;
+    block.w = w;
+    block.h = h;
+    memcpy(block.pixels, bitmap, w * h * 2);
+    xQueueSend(jpegReady, &slot, portMAX_DELAY);
+    return 1;
+}
+
+void jpegLoop(void *parameter)
+{
+    for (;;) {
+        // Wait until drawJpeg() hands us a file
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        TJpgDec.drawFsJpg(jpegX, jpegY, jpegFile);
+
+        uint8_t done = JPEG_DONE;
+        xQueueSend(jpegReady, &done, portMAX_DELAY);
+    }
+}
+
+// Set up DMA and the decoder task. Without them drawJpeg() decodes and pushes on one core.
+void jpegBegin()
+{
+    dmaReady = tft.initDMA();
+
+    jpegFree = xQueueCreate(JPEG_BLOCKS, sizeof(uint8_t));
+    jpegReady = xQueueCreate(JPEG_BLOCKS + 1, sizeof(uint8_t));
+    if (jpegFree == NULL || jpegReady == NULL) {
+        return;
+    }
+    TJpgDec.setCallback(jpegQueueBlock);
+    xTaskCreatePinnedToCore(jpegLoop, "jpeg", 6144, NULL, 1, &jpegTask, 0);
+}
+
+// Wait for a decode that drawJpeg() gave up on to post its JPEG_DONE, handing back the blocks it still
+// sends so it isn't held up. Returns false if it doesn't finish in time.
+bool jpegFinishAborted()
+{
+    uint8_t slot;
+    while (xQueueReceive(jpegReady, &slot, pdMS_TO_TICKS(JPEG_TIMEOUT)) == pdTRUE)
+    {
+        if (slot == JPEG_DONE) {
+            jpegBusy = false;
+            return true;
+        }
+        xQueueSend(jpegFree, &slot, 0);
+    }
+    return false;
+}
+
+// Draw a jpeg from SPIFFS. Call with the display held.
+void drawJpeg(int x, int y, const char *filename)
+{
+    if (jpegTask == NULL) {
+        TJpgDec.drawFsJpg(x, y, filename);
+        return;
+    }
+
+    // The queues, slots and file name can only be reused once the last job has finished
+    if (jpegBusy && !jpegFinishAborted()) {
+        Serial.println("Jpeg decoder still busy, not drawing.");
+        return;
+    }
+
+    xQueueReset(jpegReady);
+    xQueueReset(jpegFree);
+    for (uint8_t slot = 0; slot < JPEG_BLOCKS; slot++) {
+        xQueueSend(jpegFree, &slot, 0);
+    }
+
+    strncpy(jpegFile, filename, sizeof(jpegFile) - 1);
+    jpegFile[sizeof(jpegFile) - 1] = '\0';
+    jpegX = x;
+    jpegY = y;
+    jpegAbort = false;
+    jpegBusy = true;
+    xTaskNotifyGive(jpegTask);
+
+    tft.startWrite();
+    uint8_t slot;
+    uint8_t inFlight = JPEG_DONE; // Slot whose DMA transfer may still be running
+    for (;;)
+    {
+        if (xQueueReceive(jpegReady, &slot, pdMS_TO_TICKS(JPEG_TIMEOUT)) != pdTRUE) {
+            // Stalled. The decoder may still be running, the next drawJpeg() waits for it.
+            Serial.println("Jpeg decode timed out.");
+            jpegAbort = true;
+            break;
+        }
+        if (slot == JPEG_DONE) {
+            jpegBusy = false;
+            break;
+        }
+
+        JpegBlock &block = jpegBlocks[slot];
+        if (dmaReady) {
+            // Waits for the previous transfer before starting this one, so the previous slot is free after this
+            tft.pushImageDMA(block.x, block.y, block.w, block.h, block.pixels);
+            benchPixels(block.w * block.h);
+            if (inFlight != JPEG_DONE) {
+                xQueueSend(jpegFree, &inFlight, 0);
+            }
+            inFlight = slot;
+        }
+        else {
+            tft.pushImage(block.x, block.y, block.w, block.h, block.pixels);
+            benchPixels(block.w * block.h);
+            xQueueSend(jpegFree, &slot, 0);
+        }
+    }
+    if (dmaReady) {
+        tft.dmaWait();
+    }
+    tft.endWrite();
+}
+
+
 // API Request to Amplipi
-String requestAPI(String request)
+// Ask for MessagePack: it's smaller and cheaper to parse than JSON, and numbers arrive as numbers.
+// AmpliPis that can't send it answer in JSON, readDocument() handles both.
+void acceptDocument(HTTPClient &http)
+{
+    const char *headerKeys[] = { "Content-Type" };
+    http.addHeader("Accept", "application/msgpack, application/json;q=0.5");
+    http.collectHeaders(headerKeys, 1);
+}
+
+// Parse the body of a response into doc, as MessagePack or JSON depending on its Content-Type.
+// The body is read into scratch, or the heap if scratch is NULL or full.
+DeserializationError readDocument(HTTPClient &http, JsonDocument &doc, Arena *scratch = NULL)
+{
+    bool msgpack = http.header("Content-Type").startsWith("application/msgpack");
+    int size = http.getSize();
+    if (size < 0)
+    {
+        // No Content-Length, parse as it arrives
+        if (msgpack) {
+            return deserializeMsgPack(doc, http.getStream());
+        }
+        return deserializeJson(doc, http.getString());
+    }
+
+    uint8_t *body = (scratch != NULL) ? (uint8_t *)arenaAlloc(*scratch, size) : NULL;
+    bool onHeap = (body == NULL);
+    if (onHeap)
+    {
+        body = (uint8_t *)malloc(size);
+    }
+    if (body == NULL)
+    {
+        return DeserializationError::NoMemory;
+    }
+    DeserializationError error = DeserializationError::IncompleteInput;
+    if (http.getStream().readBytes(body, size) == (size_t)size)
+    {
+        // Parse from a const buffer so strings are copied into doc, body is freed below
+        const uint8_t *input = body;
+        error = msgpack ? deserializeMsgPack(doc, input, size) : deserializeJson(doc, input, size);
+    }
+    if (onHeap)
+    {
+        free(body);
+    }
+    return error;
+}
+
+// Record a parsed response. MessagePack isn't readable on Serial, so traces always hold JSON.
+void traceDocument(const char *method, const char *request, int httpCode, JsonDocument &doc)
+{
+#if RECORD_TRACE
+    String body;
+    if (httpCode == HTTP_CODE_OK) {
+        serializeJson(doc, body);
+    }
+    traceResponse(method, String(request), httpCode, body);
+#endif
+}
+
+// GET from the API and parse the response into doc. Anything but 200 leaves doc empty.
+// Call from loop() only, the url and body are kept in the refresh arena until the response is parsed.
+// request may be NULL (arenaPrintf() out of space), then nothing is sent and *code is 0.
+DeserializationError requestAPI(const char *request, JsonDocument &doc, int *code = NULL)
 {
     HTTPClient http;
+    ArenaScope scratch(refreshArena);
 
-    String url = "http://" + amplipiHostIP + "/api/" + request;
-    String payload;
+    const char *url = (request != NULL) ? arenaPrintf(refreshArena, "http://%s/api/%s", getAmpliPiHostIP().c_str(), request) : NULL;
+    if (url == NULL)
+    {
+        // Out of arena space, sending "/api/" instead would fetch the wrong thing. The next refresh tries again.
+        if (code != NULL)
+        {
+            *code = 0;
+        }
+        return DeserializationError::NoMemory;
+    }
+    DeserializationError error = DeserializationError::EmptyInput;
 
 #if DEBUGAPIREQ
     Serial.print("[HTTP] begin...\n");
     Serial.print("[HTTP] GET...\n");
 #endif
+    // Let the touch task use the SPI bus while we wait on the network
+    releaseDisplay();
+
     http.setConnectTimeout(5000);
     http.setTimeout(5000);
     http.begin(url); //HTTP
+    acceptDocument(http);
 
     // start connection and send HTTP header
     int httpCode = http.GET();
+    benchRequest();
 
     // httpCode will be negative on error
     if (httpCode > 0)
@@ -672,39 +1180,49 @@ String requestAPI(String request)
         // file found at server
         if (httpCode == HTTP_CODE_OK)
         {
-            payload = http.getString();
+            error = readDocument(http, doc, &refreshArena);
 
 #if DEBUGAPIREQ
-            Serial.println(payload);
+            serializeJson(doc, Serial);
+            Serial.println();
 #endif
-
-            // Clear the warning since we jsut received a successful API request
-            if (inWarning)
-            {
-                clearWarning();
-            }
         }
     }
     else
     {
         Serial.printf("[HTTP] GET... failed, error: %s\n", http.errorToString(httpCode).c_str());
-        drawWarning("Unable to access AmpliPi");
     }
 
     http.end();
+    traceDocument("GET", request, httpCode, doc);
+    acquireDisplay();
+
+    if (code != NULL)
+    {
+        *code = httpCode;
+    }
+
+    if (httpCode == HTTP_CODE_OK && inWarning)
+    {
+        // Clear the warning since we jsut received a successful API request
+        clearWarning();
+    }
+    else if (httpCode <= 0)
+    {
+        drawWarning("Unable to access AmpliPi");
+        requestResolve(); // The AmpliPi may have a new address
+    }
 
-    return payload;
+    return error;
 }
 
 
-// Send PATCH to API
-bool patchAPI(String request, String payload)
+// Send PATCH to API without touching the display, so any task can use it. Returns the HTTP code.
+int sendPatch(String request, String payload)
 {
     HTTPClient http;
 
-    bool result = false;
-
-    String url = "http://" + amplipiHostIP + "/api/" + request;
+    String url = "http://" + getAmpliPiHostIP() + "/api/" + request;
 
 #if DEBUGAPIREQ
     Serial.print("[HTTP] begin...\n");
@@ -719,6 +1237,7 @@ bool patchAPI(String request, String payload)
 
     // start connection and send HTTP header
     int httpCode = http.PATCH(payload);
+    benchRequest();
 
     // httpCode will be negative on error
     if (httpCode > 0)
@@ -728,18 +1247,8 @@ bool patchAPI(String request, String payload)
         Serial.printf("[HTTP] PATCH... code: %d\n", httpCode);
 #endif
 
-        // file found at server
-        if (httpCode == HTTP_CODE_OK)
-        {
-            result = true;
-
-            // Clear the warning since we jsut received a successful API request
-            if (inWarning)
-            {
-                clearWarning();
-            }
-        }
         String resultPayload = http.getString();
+        traceResponse("PATCH", request, httpCode, resultPayload);
 
 #if DEBUGAPIREQ
         Serial.println("[HTTP] PATCH result:");
@@ -749,29 +1258,53 @@ bool patchAPI(String request, String payload)
     else
     {
         Serial.printf("[HTTP] PATCH... failed, error: %s\n", http.errorToString(httpCode).c_str());
-        drawWarning("Unable to access AmpliPi");
     }
 
     http.end();
-
-    return result;
+    return httpCode;
 }
 
 
-// Send POST to API
-bool postAPI(String request, String payload)
+// Send PATCH to API
+bool patchAPI(String request, String payload)
+{
+    // Let the touch task use the SPI bus while we wait on the network
+    releaseDisplay();
+    int httpCode = sendPatch(request, payload);
+    acquireDisplay();
+
+    if (httpCode == HTTP_CODE_OK && inWarning)
+    {
+        // Clear the warning since we jsut received a successful API request
+        clearWarning();
+    }
+    else if (httpCode <= 0)
+    {
+        drawWarning("Unable to access AmpliPi");
+        requestResolve(); // The AmpliPi may have a new address
+    }
+
+    return (httpCode == HTTP_CODE_OK);
+}
+
+
+// Send POST to API
+bool postAPI(String request, String payload)
 {
     HTTPClient http;
 
     bool result = false;
 
-    String url = "http://" + amplipiHostIP + "/api/" + request;
+    String url = "http://" + getAmpliPiHostIP() + "/api/" + request;
 
 #if DEBUGAPIREQ
     Serial.print("[HTTP] begin...\n");
     Serial.print("[HTTP] POST...\n");
 #endif
 
+    // Let the touch task use the SPI bus while we wait on the network
+    releaseDisplay();
+
     http.setConnectTimeout(5000);
     http.setTimeout(5000);
     http.begin(url); //HTTP
@@ -780,6 +1313,7 @@ bool postAPI(String request, String payload)
 
     // start connection and send HTTP header
     int httpCode = http.POST(payload);
+    benchRequest();
 
     // httpCode will be negative on error
     if (httpCode > 0)
@@ -793,14 +1327,9 @@ bool postAPI(String request, String payload)
         if (httpCode == HTTP_CODE_OK)
         {
             result = true;
-
-            // Clear the warning since we jsut received a successful API request
-            if (inWarning)
-            {
-                clearWarning();
-            }
         }
         String resultPayload = http.getString();
+        traceResponse("POST", request, httpCode, resultPayload);
 
 #if DEBUGAPIREQ
         Serial.println("[HTTP] POST result:");
@@ -810,44 +1339,303 @@ bool postAPI(String request, String payload)
     else
     {
         Serial.printf("[HTTP] POST... failed, error: %s\n", http.errorToString(httpCode).c_str());
-        drawWarning("Unable to access AmpliPi");
     }
 
     http.end();
+    acquireDisplay();
+
+    if (httpCode == HTTP_CODE_OK && inWarning)
+    {
+        // Clear the warning since we jsut received a successful API request
+        clearWarning();
+    }
+    else if (httpCode <= 0)
+    {
+        drawWarning("Unable to access AmpliPi");
+        requestResolve(); // The AmpliPi may have a new address
+    }
 
     return result;
 }
 
 
-// Download album art or logo from AmpliPi API
-bool downloadAlbumart(String sourceID)
+// Album art is requested as RGB565 pixels (raw or run length encoded) at exactly the size of the
+// art box, and pushed to the display as it arrives. Servers that only send jpegs still work:
+// the jpeg is saved to /albumart.jpg and decoded from there.
+enum ArtFormat : uint8_t {
+    ART_NONE,
+    ART_JPEG,   // In /albumart.jpg
+    ART_RGB565  // Streamed from the AmpliPi, small images are also kept in /albumart.565
+};
+
+ArtFormat artFormat = ART_NONE;
+uint16_t artBand[ART_MAX_W * ART_BAND_ROWS]; // Pixels for one band of rows, in display byte order
+uint16_t artPreviewRow[ART_MAX_W / ART_PREVIEW_SCALE];
+
+
+// Push one band of art to the display. Called with the display released, while streaming.
+void pushArtBand(int x, int y, int w, int rows)
+{
+    acquireDisplay();
+    tft.setSwapBytes(false); // Pixels are already in display byte order
+    tft.pushImage(x, y, w, rows, artBand);
+    benchPixels(w * rows);
+    tft.setSwapBytes(true);
+    releaseDisplay();
+}
+
+
+// Read RGB565 art from a stream and draw it at x, y. Optionally copy what was read to cache.
+// The display must be released, it is taken for each band.
+bool pushArtStream(Stream &in, int x, int y, int w, int h, bool rle, File *cache)
 {
-    int aaW = 200;
+    int row = 0;
 
-    if (activeScreen == "select") {
-        aaW = ALBUMART_W;
+    if (!rle)
+    {
+        while (row < h)
+        {
+            int rows = min(ART_BAND_ROWS, h - row);
+            size_t len = w * rows * 2;
+            if (in.readBytes((uint8_t *)artBand, len) != len) {
+                return false;
+            }
+            if (cache) { cache->write((uint8_t *)artBand, len); }
+            pushArtBand(x, y + row, w, rows);
+            row += rows;
+        }
+        return true;
+    }
+
+    // Run length encoded: pairs of big endian run length and pixel. Runs continue across rows.
+    size_t bandLen = w * min(ART_BAND_ROWS, h);
+    size_t filled = 0;
+    uint8_t runs[256];
+    size_t kept = 0; // Bytes of a pair cut off by the last read, moved to the front of runs
+    while (row < h)
+    {
+        size_t read = in.readBytes(runs + kept, sizeof(runs) - kept);
+        if (read == 0) {
+            return false;
+        }
+        size_t got = kept + read;
+        kept = got % 4;
+        got -= kept;
+        if (cache) { cache->write(runs, got); }
+
+        for (size_t i = 0; i < got && row < h; i += 4)
+        {
+            uint16_t count = (runs[i] << 8) | runs[i + 1];
+            uint16_t pixel;
+            memcpy(&pixel, &runs[i + 2], 2); // Keep display byte order
+            while (count > 0 && row < h)
+            {
+                size_t n = min((size_t)count, bandLen - filled);
+                for (size_t p = 0; p < n; p++) {
+                    artBand[filled + p] = pixel;
+                }
+                filled += n;
+                count -= n;
+
+                if (filled == bandLen)
+                {
+                    int rows = bandLen / w;
+                    pushArtBand(x, y + row, w, rows);
+                    row += rows;
+                    filled = 0;
+                    bandLen = w * min(ART_BAND_ROWS, h - row);
+                }
+            }
+        }
+        memmove(runs, runs + got, kept);
     }
-    else if (activeScreen == "metadata"){
-        aaW = ALBUMART_FULL_W;
+    return true;
+}
+
+
+// Where the art goes on the active screen
+void albumartBox(int *x, int *y, int *w, int *h = NULL)
+{
+    const Rect &box = (activeScreen == SCREEN_METADATA) ? layout.albumArtFull : layout.albumArt;
+    *x = box.x;
+    *y = box.y;
+    *w = box.w;
+    if (h != NULL) {
+        *h = box.h;
     }
+}
+
+
+// Clear the art area around the art box
+void clearAroundAlbumart(int x, int w)
+{
+    tft.fillRect(layout.albumArtFull.x, layout.albumArtFull.y, (x - layout.albumArtFull.x), layout.albumArtFull.h, TFT_BLACK);
+    tft.fillRect((x + w), layout.albumArtFull.y, (layout.albumArtFull.x + layout.albumArtFull.w - x - w), layout.albumArtFull.h, TFT_BLACK);
+}
+
+
+// Draw the current art from the art cache, if it was saved at the width we need
+bool drawAlbumartFile(int x, int y, int w)
+{
+    File f;
+    ArtHeader header;
+    if (!artCacheOpen(artKey(currentAlbumArt), w, &f, &header)) {
+        return false;
+    }
+
+    bool ok = (header.height <= layout.albumArt.h);
+    if (ok)
+    {
+        Serial.println("Drawing album art from cache.");
+        clearAroundAlbumart(x, w);
+        releaseDisplay();
+        ok = pushArtStream(f, x, y, header.width, header.height, header.rle, NULL);
+        acquireDisplay();
+    }
+    f.close();
+    return ok;
+}
 
-    HTTPClient http;
-    bool outcome = true;
-    String url = "http://" + amplipiHostIP + "/api/sources/" + sourceID + "/image/" + String(aaW);
-    String filename = "/albumart.jpg";
+
+// Start a request for a source's album art at w x h. The display must be released.
+int requestAlbumart(HTTPClient &http, String sourceID, int w, int h, const char *format, int timeout)
+{
+    String request = "sources/" + sourceID + "/image/" + String(w) + "?height=" + String(h) + "&format=" + format;
+    String url = "http://" + getAmpliPiHostIP() + "/api/" + request;
+    const char *headerKeys[] = { "Content-Type", "X-Image-Width", "X-Image-Height" };
 
     // configure server and url
-    http.setConnectTimeout(20000);
-    http.setTimeout(20000);
+    http.setConnectTimeout(timeout);
+    http.setTimeout(timeout);
+    http.useHTTP10(true); // No chunked encoding, so the pixels can be read straight from the stream
     http.begin(url);
+    http.collectHeaders(headerKeys, 3);
 
     // start connection and send HTTP header
     int httpCode = http.GET();
+    benchRequest();
+    traceResponse("ART", request, httpCode, String());
+    return httpCode;
+}
+
+
+// Paint a tiny version of the art, scaled up, so the art area isn't left empty while the full size image downloads
+bool downloadAlbumartPreview(String sourceID)
+{
+    int aaX, aaY, aaW, aaH;
+    albumartBox(&aaX, &aaY, &aaW, &aaH);
+
+    // Servers that don't send RGB565 don't have previews either
+    if (artFormat == ART_JPEG) {
+        return false;
+    }
+
+    int w = aaW / ART_PREVIEW_SCALE;
+    int h = aaH / ART_PREVIEW_SCALE;
+    bool outcome = false;
+    HTTPClient http;
+
+    // Let the touch task use the SPI bus while we wait on the network
+    releaseDisplay();
+
+    int httpCode = requestAlbumart(http, sourceID, w, h, "rgb565", ART_PREVIEW_TIMEOUT);
+    if (httpCode == HTTP_CODE_OK && http.header("Content-Type") == "application/x-rgb565"
+        && http.header("X-Image-Width").toInt() == w && http.header("X-Image-Height").toInt() == h)
+    {
+        Stream *in = http.getStreamPtr();
+
+        acquireDisplay();
+        clearAroundAlbumart(aaX, aaW);
+        releaseDisplay();
+
+        // Each preview pixel becomes a ART_PREVIEW_SCALE square, so each preview row is one band
+        outcome = true;
+        for (int row = 0; row < h && outcome; row++)
+        {
+            if (in->readBytes((uint8_t *)artPreviewRow, w * 2) != (size_t)(w * 2)) {
+                outcome = false;
+                break;
+            }
+            // Columns past the last whole preview pixel repeat it
+            for (int x = 0; x < aaW; x++) {
+                artBand[x] = artPreviewRow[min(x / ART_PREVIEW_SCALE, w - 1)];
+            }
+            for (int line = 1; line < ART_PREVIEW_SCALE; line++) {
+                memcpy(&artBand[line * aaW], artBand, aaW * 2);
+            }
+            pushArtBand(aaX, aaY + (row * ART_PREVIEW_SCALE), aaW, ART_PREVIEW_SCALE);
+        }
+
+        // Rows below the last whole band repeat the last preview row, which is still in the band
+        if (outcome && aaH % ART_PREVIEW_SCALE != 0) {
+            pushArtBand(aaX, aaY + (h * ART_PREVIEW_SCALE), aaW, aaH % ART_PREVIEW_SCALE);
+        }
+    }
+    http.end();
+    acquireDisplay();
+    return outcome;
+}
+
+
+// Download album art or logo from AmpliPi API. RGB565 art is drawn as it arrives; jpegs are saved for drawAlbumart().
+bool downloadAlbumart(String sourceID)
+{
+    int aaX, aaY, aaW;
+    albumartBox(&aaX, &aaY, &aaW);
+
+    HTTPClient http;
+    bool outcome = true;
+    String filename = "/albumart.jpg";
+
+    // Let the touch task use the SPI bus while we wait on the network
+    releaseDisplay();
+
+    int httpCode = requestAlbumart(http, sourceID, aaW, layout.albumArt.h, "rle565", 20000);
 
 #if DEBUGAPIREQ
     Serial.println(("[HTTP] GET DONE with code " + String(httpCode)));
 #endif
 
+    String contentType = http.header("Content-Type");
+    if (httpCode == HTTP_CODE_OK && contentType.startsWith("application/x-rgb565"))
+    {
+        bool rle = contentType.startsWith("application/x-rgb565-rle");
+        int w = http.header("X-Image-Width").toInt();
+        int h = http.header("X-Image-Height").toInt();
+        int len = http.getSize();
+
+        if (w != aaW || h <= 0 || h > layout.albumArt.h)
+        {
+            Serial.println("Unexpected album art size: " + String(w) + "x" + String(h));
+            http.end();
+            acquireDisplay();
+            return false;
+        }
+
+        // Keep small images so they can be redrawn without the network, and shown at the next boot
+        SPIFFS.remove(filename);
+        File cache;
+        if (len > 0) {
+            ArtHeader header = { (uint16_t)w, (uint16_t)h, (uint16_t)rle };
+            cache = artCacheCreate(artKey(currentAlbumArt), header, len);
+        }
+
+        acquireDisplay();
+        clearAroundAlbumart(aaX, aaW);
+        releaseDisplay();
+
+        outcome = pushArtStream(*http.getStreamPtr(), aaX, aaY, w, h, rle, cache ? &cache : NULL);
+        if (cache) {
+            artCacheFinish(artKey(currentAlbumArt), w, cache, outcome);
+        }
+
+        artFormat = ART_RGB565;
+        http.end();
+        acquireDisplay();
+        updateAlbumart = !outcome;
+        return outcome;
+    }
+
     if (httpCode > 0)
     {
         Serial.println(F("-- >> OPENING FILE..."));
@@ -857,6 +1645,8 @@ bool downloadAlbumart(String sourceID)
         if (!f)
         {
             Serial.println(F("file open failed"));
+            http.end();
+            acquireDisplay();
             return false;
         }
 
@@ -874,6 +1664,7 @@ bool downloadAlbumart(String sourceID)
             Serial.println("[HTTP] connection closed or file end.");
         }
         f.close();
+        artFormat = ART_JPEG;
     }
     else
     {
@@ -883,6 +1674,7 @@ bool downloadAlbumart(String sourceID)
         outcome = false;
     }
     http.end();
+    acquireDisplay();
     return outcome;
 }
 
@@ -890,8 +1682,7 @@ bool downloadAlbumart(String sourceID)
 // Show downloaded album art of screen
 void drawAlbumart()
 {
-    int aaX = 0;
-    int aaY = 0;
+    int aaX, aaY, aaW;
 
     // Only update album art on screen if we need
     if (!updateAlbumart)
@@ -899,19 +1690,24 @@ void drawAlbumart()
         return;
     };
 
-    if (activeScreen == "select") {
-        aaX = ALBUMART_X;
-        aaY = ALBUMART_Y;
-    }
-    else if (activeScreen == "metadata"){
-        aaX = ALBUMART_FULL_X;
-        aaY = ALBUMART_FULL_Y;
+    albumartBox(&aaX, &aaY, &aaW);
+
+    if (artFormat == ART_RGB565)
+    {
+        // Streamed art isn't kept unless it's small, so fetch it again at the size this screen needs
+        if (!drawAlbumartFile(aaX, aaY, aaW) && eth_connected && hostIPKnown())
+        {
+            downloadAlbumartPreview(String(amplipiSource));
+            downloadAlbumart(String(amplipiSource));
+        }
+        updateAlbumart = false;
+        return;
     }
 
-    tft.fillRect(ALBUMART_FULL_X, ALBUMART_FULL_Y, ALBUMART_FULL_W, ALBUMART_FULL_H, TFT_BLACK); // Clear album art first
+    tft.fillRect(layout.albumArtFull.x, layout.albumArtFull.y, layout.albumArtFull.w, layout.albumArtFull.h, TFT_BLACK); // Clear album art first
     Serial.println("Drawing album art.");
 
-    TJpgDec.drawFsJpg(aaX, aaY, "/albumart.jpg");
+    drawJpeg(aaX, aaY, "/albumart.jpg");
     updateAlbumart = false;
 }
 
@@ -927,34 +1723,25 @@ void drawSource()
 
     tft.setFreeFont(FSS9);
     tft.setTextDatum(TL_DATUM);
-    tft.fillRect(SRCBAR_X, SRCBAR_Y, SRCBAR_W, SRCBAR_H, TFT_BLACK); // Clear source bar first
-    tft.drawString(currentStreamName, 38, 10, GFXFF); // Top Left
-    drawBmp("/power.bmp", 0, 0);
-    drawBmp("/source.bmp", (SRCBAR_W - 36), SRCBAR_Y);
+    tft.fillRect(layout.srcBar.x, layout.srcBar.y, layout.srcBar.w, layout.srcBar.h, TFT_BLACK); // Clear source bar first
+    tft.drawString(currentStreamName, (layout.srcBar.x + ICON_SIZE + 2), (layout.srcBar.y + 10), GFXFF); // Top Left
+    drawBmp("/power.bmp", layout.powerButton.x, layout.powerButton.y);
+    drawBmp("/source.bmp", (layout.srcButton.right() - ICON_SIZE), layout.srcButton.y);
 
     updateSource = false;
 }
 
 
-void drawSourceSelection()
+// Download the stream list for the source selection screen. Paging and scrolling draw from this copy.
+void loadStreamList()
 {
-    bool showPrev = false;
-    bool showNext = false;
-    String streamName = "";
-
-    // Stop metadata refresh
-    metadata_refresh = false;
-
-    Serial.println("Opening source selection screen.");
+    Serial.println("Loading stream list.");
 
-    // Download source options
-    String status_json = requestAPI("streams"); // Requesting /api/streams
-    
-    // DynamicJsonDocument<N> allocates memory on the heap
-    DynamicJsonDocument apiStatus(6144);
+    // Download source options. The document is only needed until the list is copied.
+    ArenaScope screen(screenArena);
+    ScreenJsonDocument apiStatus(6144);
 
-    // Deserialize the JSON document
-    DeserializationError error = deserializeJson(apiStatus, status_json);
+    DeserializationError error = requestAPI("streams", apiStatus); // Requesting /api/streams
 
     // Test if parsing succeeds.
     if (error)
@@ -963,274 +1750,433 @@ void drawSourceSelection()
         Serial.println(error.f_str());
     }
 
-    // Clear screen
-    clearMainArea();
-
-    // Draw size selecton boxes
-    tft.setTextDatum(TL_DATUM);
-    //tft.setTextColor(TFT_WHITE, TFT_NAVY);
-    tft.setFreeFont(FSS12);
+    // 'OFF' and 'Local - RCA' options are always at the top of the list
+    streamList[0].id = -1;
+    strncpy(streamList[0].name, "OFF", sizeof(streamList[0].name));
+    streamList[1].id = 0;
+    strncpy(streamList[1].name, "Local - RCA", sizeof(streamList[1].name));
+    streamListCount = 2;
 
-    Serial.print("currentSourceOffset: ");
-    Serial.println(currentSourceOffset);
     Serial.println("Streams:");
-    int bi = 0; // Base iterator within 'print MAX_STREAMS items' loop (0-6)
-    int i = 0; // Stream iterator
-    int itemH = 54;
-    int maxstreams = currentSourceOffset + MAX_STREAMS;
-
-    uint16_t vlightgrey = tft.color565(240, 240, 240);
-    tft.setTextColor(TFT_BLACK, vlightgrey);
-    
-    // Start with showing 'OFF' and 'Local - RCA' options at top of the list
-    if (currentSourceOffset <= 0) {
-        // Display 'OFF' button
-        tft.fillRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), TFT_WIDTH, 38, vlightgrey); // Selection box background
-        tft.fillRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), 12, 38, TFT_RED); // Left marker on selection box
-        tft.drawRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), TFT_WIDTH, 38, TFT_RED); // Selection box
-        tft.drawString("OFF", (MAINZONE_X + 15), (MAINZONE_Y + (itemH * bi) + 10));
-        sourceIDs[bi] = -1;
-        ++bi;
-        ++i;
-
-        // Display 'Local - RCA' button
-        //tft.setTextColor(TFT_WHITE, TFT_NAVY);
-        tft.fillRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), TFT_WIDTH, 38, vlightgrey); // Selection box background
-        tft.fillRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), 12, 38, TFT_NAVY); // Left marker on selection box
-        tft.drawRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), TFT_WIDTH, 38, TFT_NAVY); // Selection box
-        tft.drawString("Local - RCA", (MAINZONE_X + 15), (MAINZONE_Y + (itemH * bi) + 10));
-        sourceIDs[bi] = 0;
-        ++bi;
-        ++i;
-    }
-    else {
-        currentSourceOffset = currentSourceOffset - 2; // Subtract the 'OFF' and 'Local - RCA' buttons
-    }
-
-    int currentSO = currentSourceOffset;
-    bool zone2Enabled = amplipiZone2Enabled;
-
-    Serial.print("Max streams: ");
-    Serial.println(maxstreams);
     for (JsonObject value : apiStatus["streams"].as<JsonArray>()) {
-        JsonObject thisStream = value;
-        streamName = thisStream["name"].as<String>();
-        Serial.print(thisStream["id"].as<String>());
+        if (streamListCount >= MAX_STREAM_LIST) {
+            break;
+        }
+
+        String streamName = value["name"].as<String>();
+        Serial.print(value["id"].as<String>());
         Serial.print(" - ");
-        Serial.print(streamName);
-        
+        Serial.println(streamName);
+
         if (streamName.length() > SRC_NAME_LEN) {
             streamName = streamName.substring(0,SRC_NAME_LEN) + "...";
         }
 
-        // Only print MAX_STREAM number of items on screen, but continue iterating through the rest of the list
-        if (i >= currentSO && i < maxstreams)
-        {
-            Serial.print(" - String X: ");
-            Serial.print((MAINZONE_X + 12));
-            Serial.print(" - String Y: ");
-            Serial.println((MAINZONE_Y + (itemH * bi) + 10));
+        // Get the logo ready for when this stream is picked
+        String logo = value["logo"].as<String>();
+        if (logo != "null" && logo.length() > 0) {
+            uint32_t key = artKey(logo);
+            artPrefetch(key, ART_PREFETCH_W, "streams/image/" + value["id"].as<String>() + "?width=" + String(ART_PREFETCH_W)
+                + "&height=" + String(layout.albumArt.h) + "&format=rle565&url_hash=" + String(key, HEX));
+        }
+
+        StreamListItem &item = streamList[streamListCount];
+        item.id = value["id"].as<int>();
+        strncpy(item.name, streamName.c_str(), sizeof(item.name));
+        item.name[sizeof(item.name) - 1] = '\0';
+        ++streamListCount;
+    }
+}
+
 
-            // Add to sourceIDs array to be used in the main loop when one of the button is selected
-            sourceIDs[bi] = thisStream["id"].as<int>();
+// Draw one row of the source list. canvas is either the screen or the list sprite, which takes palette indexes as colors.
+template <typename T>
+void drawSourceRow(T &canvas, int row, int y, uint16_t boxColor, uint16_t markerColor, uint16_t textColor)
+{
+    canvas.fillRect(0, y, layout.sourceList.w, SOURCEBOX_H, boxColor); // Selection box background
+    canvas.fillRect(0, y, 12, SOURCEBOX_H, markerColor); // Left marker on selection box
+    canvas.drawRect(0, y, layout.sourceList.w, SOURCEBOX_H, markerColor); // Selection box
+    canvas.setTextColor(textColor, boxColor);
+    canvas.drawString(streamList[row].name, 15, (y + 10));
+}
+
+
+int maxSourceScroll()
+{
+    int listH = streamListCount * SOURCEITEM_H;
+    return (listH > layout.sourceList.h) ? (listH - layout.sourceList.h) : 0;
+}
+
+
+// Draw the list rows that overlap sprite lines top to bottom
+void renderSourceListBand(int top, int bottom)
+{
+    listSprite.fillRect(0, top, layout.sourceList.w, (bottom - top), LIST_BLACK);
+    listSprite.setTextDatum(TL_DATUM);
+    listSprite.setFreeFont(FSS12);
+
+    int first = (top + sourceScrollY) / SOURCEITEM_H;
+    int last = (bottom - 1 + sourceScrollY) / SOURCEITEM_H;
+    for (int row = first; row <= last && row < streamListCount; row++)
+    {
+        drawSourceRow(listSprite, row, (row * SOURCEITEM_H) - sourceScrollY, LIST_BOX, (row == 0) ? LIST_RED : LIST_NAVY, LIST_BLACK);
+    }
+}
+
+
+void pushSourceList()
+{
+    // Palette colors are already in display order
+    tft.setSwapBytes(false);
+    listSprite.pushSprite(layout.sourceList.x, layout.sourceList.y);
+    tft.setSwapBytes(true);
+    benchPixels(listSprite.width() * listSprite.height());
+}
+
+
+// Without the sprite, draw the rows that fit completely straight to the screen
+void drawSourceListDirect()
+{
+    uint16_t vlightgrey = tft.color565(240, 240, 240);
+
+    tft.fillRect(layout.sourceList.x, layout.sourceList.y, layout.sourceList.w, layout.sourceList.h, TFT_BLACK);
+    benchPixels(layout.sourceList.w * layout.sourceList.h);
+    tft.setTextDatum(TL_DATUM);
+    tft.setFreeFont(FSS12);
 
-            // Display stream button
-            tft.fillRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), TFT_WIDTH, 38, vlightgrey); // Selection box background
-            tft.fillRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), 12, 38, TFT_NAVY); // Left marker on selection box
-            tft.drawRect(MAINZONE_X, (MAINZONE_Y + (itemH * bi)), TFT_WIDTH, 38, TFT_NAVY); // Selection box
-            tft.drawString(streamName, (MAINZONE_X + 15), (MAINZONE_Y + (itemH * bi) + 10));
-            ++bi;
+    int first = sourceScrollY / SOURCEITEM_H;
+    for (int row = first; row < streamListCount; row++)
+    {
+        int y = (row * SOURCEITEM_H) - sourceScrollY;
+        if (y + SOURCEBOX_H > layout.sourceList.h) {
+            break;
         }
-        Serial.print("i: ");
-        Serial.println(i);
-        ++i;
+        drawSourceRow(tft, row, (layout.sourceList.y + y), vlightgrey, (row == 0) ? TFT_RED : TFT_NAVY, TFT_BLACK);
     }
-    currentSourceOffset = currentSO; // Fixes a bug where going through more than 6 items on the JSON array sets the currentSourceOffset to the sixth item's ID
-    amplipiZone2Enabled = zone2Enabled; // Also affects this global setting
+}
+
 
-    if (i > (MAX_STREAMS + currentSourceOffset)) { showNext = true; }
-    if (currentSourceOffset > 0) { showPrev = true; }
+// Show or hide the Back and Next buttons to match the scroll position
+void drawPageButtons(bool force)
+{
+    bool showPrev = (sourceScrollY > 0);
+    bool showNext = (sourceScrollY < maxSourceScroll());
 
-    // Previous and Next buttons
+    tft.setFreeFont(FSS12);
     tft.setTextDatum(TC_DATUM);
     tft.setTextColor(TFT_WHITE, TFT_DARKGREY);
 
     // Previous button
-    if (showPrev)
+    if (force || showPrev != showPrevButton)
     {
-        tft.fillRoundRect(LEFTBUTTON_X, LEFTBUTTON_Y, LEFTBUTTON_W, LEFTBUTTON_H, 6, TFT_DARKGREY);
-        tft.drawString("< Back", (LEFTBUTTON_X + 60), (LEFTBUTTON_Y + 15));
+        if (showPrev) {
+            tft.fillRoundRect(layout.leftButton.x, layout.leftButton.y, layout.leftButton.w, layout.leftButton.h, 6, TFT_DARKGREY);
+            tft.drawString("< Back", (layout.leftButton.x + 60), (layout.leftButton.y + 15));
+        }
+        else {
+            tft.fillRect(layout.leftButton.x, layout.leftButton.y, layout.leftButton.w, layout.leftButton.h, TFT_BLACK);
+        }
     }
 
-    // Settings button
-    drawBmp("/settings.bmp", CENTERBUTTON_X, CENTERBUTTON_Y);
-
     // Next button
-    if (showNext)
+    if (force || showNext != showNextButton)
     {
-        tft.fillRoundRect(RIGHTBUTTON_X, RIGHTBUTTON_Y, RIGHTBUTTON_W, RIGHTBUTTON_H, 6, TFT_DARKGREY);
-        tft.drawString("Next >", (RIGHTBUTTON_X + 60), (RIGHTBUTTON_Y + 15));
+        if (showNext) {
+            tft.fillRoundRect(layout.rightButton.x, layout.rightButton.y, layout.rightButton.w, layout.rightButton.h, 6, TFT_DARKGREY);
+            tft.drawString("Next >", (layout.rightButton.x + 60), (layout.rightButton.y + 15));
+        }
+        else {
+            tft.fillRect(layout.rightButton.x, layout.rightButton.y, layout.rightButton.w, layout.rightButton.h, TFT_BLACK);
+        }
     }
 
+    showPrevButton = showPrev;
+    showNextButton = showNext;
+
     // Reset to default
     tft.setTextDatum(TL_DATUM);
     tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.setFreeFont(FSS12);
-
 }
 
 
-void selectSource(int y)
+void drawSourceSelection()
 {
-    // Send source selection
-    Serial.print("Source Select - Y: ");
-    Serial.println(y);
-
-    /* Box Y values. Selection boxes are 38 pixels tall, with 4 pixels between boxes
-    1: 36 - 74
-    2: 78 - 116
-    3: 120 - 158
-    4: 162 - 200
-    5: 204 - 242
-    6: 246 - 284
-    -- If screen length is greater than 320px:
-    7: 288 - 326
-    8: 330 - 368
-    9: 372 - 410
-
-    Add a couple pixels around the boxes:
-    */
-    int selected = 0;
-    if (y >= 36 && y <= 76) { selected = 0; }
-    else if (y >= 77 && y <= 118) { selected = 1; }
-    else if (y >= 119 && y <= 160) { selected = 2; }
-    else if (y >= 161 && y <= 202) { selected = 3; }
-    else if (y >= 203 && y <= 244) { selected = 4; }
-    else if (y >= 245 && y <= 286) { selected = 5; }
-    else if (y >= 287 && y <= 328) { selected = 6; }
-    else if (y >= 329 && y <= 370) { selected = 7; }
-    else if (y >= 371 && y <= 412) { selected = 8; }
+    // Stop metadata refresh
+    metadata_refresh = false;
 
-    String inputID;
-    if (sourceIDs[selected] == -1) {
-        inputID = "None";
+    Serial.println("Opening source selection screen.");
+
+    // Clear screen
+    clearMainArea();
+
+    // Scrolling needs the whole list area in a sprite. Without the memory for it we fall back to pages.
+    if (!listSpriteReady)
+    {
+        listSprite.setColorDepth(4);
+        listSpriteReady = (listSprite.createSprite(layout.sourceList.w, layout.sourceList.h) != NULL);
+        if (listSpriteReady) {
+            uint16_t palette[16] = { TFT_BLACK, tft.color565(240, 240, 240), TFT_NAVY, TFT_RED };
+            listSprite.createPalette(palette);
+        }
+        else {
+            Serial.println("Not enough memory for source list scrolling.");
+        }
     }
-    else if (sourceIDs[selected] == 0) {
-        inputID = "local";
+
+    if (listSpriteReady) {
+        renderSourceListBand(0, layout.sourceList.h);
+        pushSourceList();
     }
     else {
-        inputID = "stream=" + String(sourceIDs[selected]);
+        drawSourceListDirect();
     }
 
-    // Send to API
-    String payload = "{\"input\": \"" + inputID + "\"}";
-    Serial.println(payload);
-    bool result = patchAPI("sources/" + String(amplipiSource), payload);
-    Serial.print("selectSource result: ");
-    Serial.println(result);
-}
-
+    // Settings button
+    drawBmp("/settings.bmp", layout.centerButton.x, layout.centerButton.y);
 
-void powerOffScreen() {
-    // Stop metadata refresh
-    metadata_refresh = false;
+    drawPageButtons(true);
 
-    // Clear screen
-    tft.fillRect(0, 0, TFT_WIDTH, TFT_HEIGHT, TFT_BLACK);
+    // Reset to default
+    tft.setTextDatum(TL_DATUM);
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    tft.setFreeFont(FSS12);
+}
 
-    // Turn off backlight
-    digitalWrite(TFT_BL, LOW);
 
+// Free the list sprite when leaving the source selection screen
+void closeSourceSelection()
+{
+    if (listSpriteReady) {
+        listSprite.deleteSprite();
+        listSpriteReady = false;
+    }
+    sourceScrollVelocity = 0;
 }
 
-void powerOnScreen() {
-    // Turn on backlight
-    digitalWrite(TFT_BL, HIGH);
-}
 
-void drawSettings()
+// Scroll the source list to a new position. Rows that are already drawn are moved in the sprite,
+// and only the rows that scroll into view are drawn.
+void scrollSourceList(int newScroll)
 {
-    // Available settings:
-    // - Select zones to manage
-    // - Reset WiFi settings (delete 'wifi.json' config file and reboot, or enable web server to select AP)
-    // - Restart
-    // - Show version, Wifi AP, IP address
+    if (newScroll < 0) { newScroll = 0; }
+    if (newScroll > maxSourceScroll()) { newScroll = maxSourceScroll(); }
 
-    // Stop metadata refresh
-    metadata_refresh = false;
+    int delta = newScroll - sourceScrollY;
+    if (delta == 0) {
+        return;
+    }
+    sourceScrollY = newScroll;
 
-    // Clear screen
-    clearMainArea();
+    if (!listSpriteReady) {
+        drawSourceListDirect();
+    }
+    else if (abs(delta) >= layout.sourceList.h) {
+        renderSourceListBand(0, layout.sourceList.h);
+        pushSourceList();
+    }
+    else {
+        uint8_t *lines = (uint8_t *)listSprite.getPointer();
+        size_t lineBytes = layout.sourceList.w / 2; // 4 bits per pixel
 
-    // Show settings:
-    // Zone 1
-    tft.setFreeFont(FSS12);
-    tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.drawString("Zone 1: " + String(amplipiZone1), 5, 55);
+        if (delta > 0) {
+            // List moves up, new rows appear at the bottom
+            memmove(lines, lines + (delta * lineBytes), (layout.sourceList.h - delta) * lineBytes);
+            renderSourceListBand((layout.sourceList.h - delta), layout.sourceList.h);
+        }
+        else {
+            // List moves down, new rows appear at the top
+            memmove(lines + (-delta * lineBytes), lines, (layout.sourceList.h + delta) * lineBytes);
+            renderSourceListBand(0, -delta);
+        }
+        pushSourceList();
+    }
 
-    tft.setTextColor(TFT_WHITE, TFT_DARKGREEN);
-    tft.fillRoundRect((TFT_WIDTH - 80), 50, 36, 36, 6, TFT_DARKGREEN);
-    tft.drawString("<", (TFT_WIDTH - 70), 55);
-    tft.fillRoundRect((TFT_WIDTH - 40), 50, 36, 36, 6, TFT_DARKGREEN);
-    tft.drawString(">", (TFT_WIDTH - 28), 55);
+    drawPageButtons(false);
+}
 
-    tft.fillRect(20, 80, (TFT_WIDTH - 40), 1, GREY); // Seperator
-    
-    // Zone 2
-    tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    String thisZone;
-    if (atoi(amplipiZone2) < 0) { thisZone = "None"; }
-    else { thisZone = String(amplipiZone2); }
-    tft.drawString("Zone 2: " + thisZone, 5, 90);
 
-    tft.setTextColor(TFT_WHITE, TFT_DARKGREEN);
-    tft.fillRoundRect((TFT_WIDTH - 80), 90, 36, 36, 6, TFT_DARKGREEN);
-    tft.drawString("<", (TFT_WIDTH - 70), 95);
-    tft.fillRoundRect((TFT_WIDTH - 40), 90, 36, 36, 6, TFT_DARKGREEN);
-    tft.drawString(">", (TFT_WIDTH - 28), 95);
-    
-    tft.fillRect(20, 120, (TFT_WIDTH - 40), 1, GREY); // Seperator
+// Move the list by a page, one screenful of whole rows
+void pageSourceList(int direction)
+{
+    sourceScrollVelocity = 0;
+    int pageH = (layout.sourceList.h / SOURCEITEM_H) * SOURCEITEM_H;
+    int newScroll = ((sourceScrollY / SOURCEITEM_H) * SOURCEITEM_H) + (direction * pageH);
+    scrollSourceList(newScroll);
+}
+
+
+// Keep the list moving after a flick, slowing down until it stops
+void animateSourceList()
+{
+    static float scrollPos = 0;
+
+    if (sourceScrollVelocity == 0 || activeScreen != SCREEN_SOURCE) {
+        scrollPos = sourceScrollY;
+        return;
+    }
+
+    unsigned long now = millis();
+    unsigned long elapsed = now - lastScrollFrame;
+    if (elapsed < SCROLL_FRAME_INTERVAL) {
+        return;
+    }
+    lastScrollFrame = now;
+
+    scrollPos -= sourceScrollVelocity * elapsed; // Finger moving down scrolls towards the top
+    sourceScrollVelocity *= (1.0 - (SCROLL_FRICTION * elapsed));
+    if (abs(sourceScrollVelocity) < 0.02 || scrollPos <= 0 || scrollPos >= maxSourceScroll()) {
+        sourceScrollVelocity = 0;
+    }
+    scrollSourceList((int)scrollPos);
+}
+
+
+void selectSource(int row)
+{
+    // Send source selection
+    Serial.print("Source Select - Row: ");
+    Serial.println(row);
+
+    if (row < 0 || row >= streamListCount) {
+        return;
+    }
+
+    String inputID;
+    if (streamList[row].id == -1) {
+        inputID = "None";
+    }
+    else if (streamList[row].id == 0) {
+        inputID = "local";
+    }
+    else {
+        inputID = "stream=" + String(streamList[row].id);
+    }
+
+    // Send to API
+    String payload = "{\"input\": \"" + inputID + "\"}";
+    Serial.println(payload);
+    bool result = patchAPI("sources/" + String(amplipiSource), payload);
+    Serial.print("selectSource result: ");
+    Serial.println(result);
+}
+
+
+// Switch to the layout of a rotation. What was sized for the old layout is let go, to be made again the
+// next time it's used.
+void applyLayout(uint8_t rotation)
+{
+    layout = (rotation & 1) ? landscapeLayout : portraitLayout;
+    closeSourceSelection();
+    forgetVolumeBars();
+}
+
+// Power button, or nobody touched the panel for IDLE_OFF_TIMEOUT
+void powerOffScreen() {
+    // Keep the main screen to show straight away on wake. The art is left out when the art cache has it.
+    frameCacheClear();
+    if (activeScreen == SCREEN_SELECT || activeScreen == SCREEN_METADATA) {
+        int aaX, aaY, aaW;
+        albumartBox(&aaX, &aaY, &aaW);
+        frameScreen = activeScreen;
+        frameArtLeftOut = artCacheHas(artKey(currentAlbumArt), aaW);
+        frameCacheSave(&tft, frameArtLeftOut ? rect(aaX, aaY, aaW, layout.albumArt.h) : rect(0, 0, 0, 0));
+    }
+
+    closeSourceSelection();
+    activeScreen = SCREEN_OFF;
+
+    // Stop metadata refresh
+    metadata_refresh = false;
+
+    // Clear screen
+    tft.fillRect(0, 0, layout.screen.w, layout.screen.h, TFT_BLACK);
+    benchPixels(layout.screen.w * layout.screen.h);
+    textLineHide(songLine);
+    forgetVolumeBars();
+
+    // Turn off backlight, and slow the CPU down
+    idleSetState(IDLE_OFF);
+}
+
+void powerOnScreen() {
+    // Turn on backlight
+    idleSetState(IDLE_ACTIVE);
+}
 
-    // Source
+// Value of a setting, in the left of its row. Also used when the < and > buttons change it.
+void drawSettingValue(const Rect &row, const String &text)
+{
     tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.drawString("Source: " + String(amplipiSource), 5, 130);
+    tft.fillRect(row.x, row.y, row.w, row.h, TFT_BLACK);
+    tft.drawString(text, (row.x + 5), (row.y + 14));
+}
 
+// The < and > buttons of a setting, and the separator under its row
+void drawStepButtons(const Rect &row, const Rect &down, const Rect &up)
+{
     tft.setTextColor(TFT_WHITE, TFT_DARKGREEN);
-    tft.fillRoundRect((TFT_WIDTH - 80), 130, 36, 36, 6, TFT_DARKGREEN);
-    tft.drawString("<", (TFT_WIDTH - 70), 135);
-    tft.fillRoundRect((TFT_WIDTH - 40), 130, 36, 36, 6, TFT_DARKGREEN);
-    tft.drawString(">", (TFT_WIDTH - 28), 135);
+    tft.fillRoundRect(down.x, down.y, down.w, down.h, 6, TFT_DARKGREEN);
+    tft.drawString("<", (down.x + 10), (down.y + 5));
+    tft.fillRoundRect(up.x, up.y, up.w, up.h, 6, TFT_DARKGREEN);
+    tft.drawString(">", (up.x + 12), (up.y + 5));
 
-    tft.fillRect(20, 170, (TFT_WIDTH - 40), 1, GREY); // Seperator
+    tft.fillRect((row.x + 20), (row.bottom() + 1), (row.w + 2 * SETTING_PITCH - 40), 1, GREY); // Seperator
+}
 
-    // Restart Controller
-    tft.setFreeFont(FSS9);
+void drawSettingButton(const Rect &button, const char *label)
+{
     tft.setTextColor(TFT_WHITE, TFT_DARKGREEN);
-    tft.fillRoundRect(0, 180, TFT_WIDTH, 36, 6, TFT_DARKGREEN);
-    tft.drawString("Reboot Controller", 10, 188);
+    tft.fillRoundRect(button.x, button.y, button.w, button.h, 6, TFT_DARKGREEN);
+    tft.drawString(label, (button.x + 10), (button.y + 8));
+}
+
+void drawSettings()
+{
+    // Available settings:
+    // - Select zones to manage
+    // - Reset WiFi settings (delete 'wifi.json' config file and reboot, or enable web server to select AP)
+    // - Restart
+    // - Show version, Wifi AP, IP address
+
+    // Stop metadata refresh
+    metadata_refresh = false;
+
+    // Clear screen
+    clearMainArea();
+
+    // Show settings
+    tft.setFreeFont(FSS12);
+    drawSettingValue(layout.zone1Row, "Zone 1: " + String(amplipiZone1));
+    drawStepButtons(layout.zone1Row, layout.zone1Down, layout.zone1Up);
+
+    String thisZone;
+    if (atoi(amplipiZone2) < 0) { thisZone = "None"; }
+    else { thisZone = String(amplipiZone2); }
+    drawSettingValue(layout.zone2Row, "Zone 2: " + thisZone);
+    drawStepButtons(layout.zone2Row, layout.zone2Down, layout.zone2Up);
 
-    // Re-calibrate touchscreen
-    tft.fillRoundRect(0, 220, TFT_WIDTH, 36, 6, TFT_DARKGREEN);
-    tft.drawString("Re-calibrate Touchscreen", 10, 228);
+    drawSettingValue(layout.sourceRow, "Source: " + String(amplipiSource));
+    drawStepButtons(layout.sourceRow, layout.sourceDown, layout.sourceUp);
 
-    // Rotate touchscreen up and down
-    tft.fillRoundRect(0, 260, TFT_WIDTH, 36, 6, TFT_DARKGREEN);
-    tft.drawString("Flip Screen & Re-calibrate", 10, 268);
+    tft.setFreeFont(FSS9);
+    drawSettingButton(layout.rebootButton, "Reboot Controller");
+    drawSettingButton(layout.recalibrateButton, "Re-calibrate Touchscreen");
+    drawSettingButton(layout.rotateButton, "Rotate Screen"); // A quarter turn clockwise, keeping the calibration
 
     // Save, About, and Cancel buttons
     tft.setTextDatum(TC_DATUM);
     tft.setFreeFont(FSS12);
     tft.setTextColor(TFT_WHITE, TFT_DARKGREY);
 
-    tft.fillRoundRect(LEFTBUTTON_X, LEFTBUTTON_Y, LEFTBUTTON_W, LEFTBUTTON_H, 6, TFT_DARKGREY);
-    tft.drawString("Save", (LEFTBUTTON_X + 60), (RIGHTBUTTON_Y + 15));
+    tft.fillRoundRect(layout.leftButton.x, layout.leftButton.y, layout.leftButton.w, layout.leftButton.h, 6, TFT_DARKGREY);
+    tft.drawString("Save", (layout.leftButton.x + 60), (layout.rightButton.y + 15));
 
     tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-    tft.drawString("?", (CENTERBUTTON_X + 22), (CENTERBUTTON_Y + 15)); // About
+    tft.drawString("?", (layout.centerButton.x + 22), (layout.centerButton.y + 15)); // About
 
     tft.setTextColor(TFT_WHITE, TFT_DARKGREY);
-    tft.fillRoundRect(RIGHTBUTTON_X, RIGHTBUTTON_Y, RIGHTBUTTON_W, RIGHTBUTTON_H, 6, TFT_DARKGREY);
-    tft.drawString("Cancel", (RIGHTBUTTON_X + 60), (RIGHTBUTTON_Y + 15));
+    tft.fillRoundRect(layout.rightButton.x, layout.rightButton.y, layout.rightButton.w, layout.rightButton.h, 6, TFT_DARKGREY);
+    tft.drawString("Cancel", (layout.rightButton.x + 60), (layout.rightButton.y + 15));
 
     // Reset to default
     tft.setTextDatum(TL_DATUM);
@@ -1239,14 +2185,41 @@ void drawSettings()
 }
 
 
+// Turn the screen to another rotation and lay the settings screen out again. The calibration is turned
+// with it, so there's nothing to touch again and no reboot.
+void rotateScreen(uint8_t rotation)
+{
+    Serial.printf("Rotating screen from %d to %d\n", screenRotation, rotation);
+
+    uint16_t calData[5];
+    if (loadTouchCalibration(calData)) {
+        touchRotateCalibration(calData, screenRotation, rotation);
+        saveTouchCalibration(calData);
+        tft.setTouch(calData);
+    }
+    screenRotation = rotation;
+    tft.setRotation(rotation);
+    applyLayout(rotation);
+
+    // The touch that pressed the button was taken at the old rotation
+    touchFlush();
+    gestureCancel();
+
+    tft.fillScreen(TFT_BLACK);
+    updateSource = true;
+    drawSource();
+    drawSettings();
+}
+
+
 void drawAbout()
 {
-    activeScreen = "about";
+    activeScreen = SCREEN_ABOUT;
 
     // Pull latest version number from a remote source (AmpliPi)
     HTTPClient http;
 
-    String url = "http://" + amplipiHostIP + controllerVersionURI;
+    String url = "http://" + getAmpliPiHostIP() + controllerVersionURI;
     String payload;
     String latestVersion = "";
 
@@ -1308,7 +2281,7 @@ void drawAbout()
 
     tft.drawString("ETH: " + String(ETH.linkSpeed()) + "Mbps" + DX, 5, 96);
 
-    tft.fillRect(20, 120, (TFT_WIDTH - 40), 1, GREY); // Seperator
+    tft.fillRect(20, 120, (layout.screen.w - 40), 1, GREY); // Seperator
     
     tft.drawString("Controller Version:", 5, 125);
     tft.drawString(String(VERSION), 5, 145);
@@ -1316,7 +2289,7 @@ void drawAbout()
     tft.drawString(latestVersion, 5, 190);
 
     // AmpliPi logo
-    tft.setCursor((TFT_WIDTH / 3) - 15, 265, 2); // center
+    tft.setCursor((layout.screen.w / 3) - 15, layout.logo.y, 2); // center
     tft.setFreeFont(FSS18);
     tft.print("Ampli");
     tft.setTextColor(TFT_RED, TFT_BLACK);
@@ -1327,13 +2300,14 @@ void drawAbout()
     tft.setTextDatum(TC_DATUM);
     tft.setTextColor(TFT_WHITE, TFT_DARKGREY);
 
-    tft.fillRoundRect(LEFTBUTTON_X, LEFTBUTTON_Y, LEFTBUTTON_W, LEFTBUTTON_H, 6, TFT_DARKGREY);
-    tft.drawString("Close", (LEFTBUTTON_X + 60), (LEFTBUTTON_Y + 15));
+    tft.fillRoundRect(layout.leftButton.x, layout.leftButton.y, layout.leftButton.w, layout.leftButton.h, 6, TFT_DARKGREY);
+    tft.drawString("Close", (layout.leftButton.x + 60), (layout.leftButton.y + 15));
 
-    if (latestVersion != "Unavailable" && String(VERSION) != latestVersion) {
+    updateAvailable = (latestVersion != "Unavailable" && String(VERSION) != latestVersion);
+    if (updateAvailable) {
         // Show Update button
-        tft.fillRoundRect(RIGHTBUTTON_X, RIGHTBUTTON_Y, RIGHTBUTTON_W, RIGHTBUTTON_H, 6, TFT_DARKGREY);
-        tft.drawString("Update", (RIGHTBUTTON_X + 60), (RIGHTBUTTON_Y + 15));
+        tft.fillRoundRect(layout.rightButton.x, layout.rightButton.y, layout.rightButton.w, layout.rightButton.h, 6, TFT_DARKGREY);
+        tft.drawString("Update", (layout.rightButton.x + 60), (layout.rightButton.y + 15));
         tft.setTextColor(TFT_WHITE, TFT_DARKGREY);
     }
     // Reset to default
@@ -1343,6 +2317,55 @@ void drawAbout()
 }
 
 
+// Zone details, opened with a long press on a mute button. Any tap goes back to the main screen.
+void drawZoneDetails(int zone)
+{
+    activeScreen = SCREEN_ZONE;
+
+    // Stop metadata refresh
+    metadata_refresh = false;
+
+    const char *zoneID = (zone == 2) ? amplipiZone2 : amplipiZone1;
+    ArenaScope screen(screenArena);
+    ScreenJsonDocument zoneStatus(1000);
+    DeserializationError error = requestAPI(arenaPrintf(screenArena, "zones/%s", zoneID), zoneStatus);
+
+    // Test if parsing succeeds.
+    if (error)
+    {
+        Serial.print(F("drawZoneDetails() deserializeJson() failed: "));
+        Serial.println(error.f_str());
+    }
+
+    // Clear screen
+    clearMainArea();
+
+    tft.setFreeFont(FSS12);
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    String zoneName = zoneStatus["name"].as<String>();
+    if (zoneName == "null") {
+        zoneName = "Zone " + String(zoneID);
+    }
+    tft.drawString(zoneName, 5, 50);
+    tft.fillRect(20, 80, (layout.screen.w - 40), 1, GREY); // Seperator
+
+    tft.setFreeFont(FSS9);
+    tft.drawString("Zone ID: " + String(zoneID), 5, 90);
+    tft.drawString("Volume: " + String(zoneStatus["vol"].as<int>()) + " dB", 5, 113);
+    tft.drawString("Muted: " + String(zoneStatus["mute"].as<bool>() ? "Yes" : "No"), 5, 136);
+    tft.drawString("Source: " + String(zoneStatus["source_id"].as<int>()), 5, 159);
+
+    tft.setTextDatum(TC_DATUM);
+    tft.setTextColor(GREY, TFT_BLACK);
+    tft.drawString("Tap to close", (layout.screen.w / 2), (layout.leftButton.y + 15));
+
+    // Reset to default
+    tft.setTextDatum(TL_DATUM);
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    tft.setFreeFont(FSS12);
+}
+
+
 // Handle update of this device from OTA path
 // From: https://github.com/espressif/arduino-esp32/blob/master/libraries/Update/examples/AWS_S3_OTA_Update/AWS_S3_OTA_Update.ino
 
@@ -1369,6 +2392,7 @@ void updateController()
     tft.drawString("minutes.", 5, 130);
 
     // Download and update this device
+    String amplipiHostIP = getAmpliPiHostIP();
     Serial.println("Connecting to: " + String(amplipiHostIP));
     int port = 80;
 #if DEBUG_WEBSERVER
@@ -1533,8 +2557,8 @@ void updateController()
     tft.setTextDatum(TC_DATUM);
     tft.setTextColor(TFT_WHITE, TFT_DARKGREY);
 
-    tft.fillRoundRect(LEFTBUTTON_X, LEFTBUTTON_Y, LEFTBUTTON_W, LEFTBUTTON_H, 6, TFT_DARKGREY);
-    tft.drawString("Close", (MAINZONE_X + 60), (LEFTBUTTON_Y + 15));
+    tft.fillRoundRect(layout.leftButton.x, layout.leftButton.y, layout.leftButton.w, layout.leftButton.h, 6, TFT_DARKGREY);
+    tft.drawString("Close", (layout.mainZone.x + 60), (layout.leftButton.y + 15));
     tft.setTextColor(TFT_WHITE, TFT_DARKGREY);
     tft.setTextColor(TFT_WHITE, TFT_BLACK);
 }
@@ -1542,37 +2566,42 @@ void updateController()
 
 void drawCommandButtons()
 {
+    // No room for them on this panel and rotation, see landscapeCommand()
+    if (layout.playPauseButton.w == 0) {
+        return;
+    }
+
     // Currently, only Pandora streams support these buttons
     if (currentStreamType == "pandora")
     {
         if (cmdLike) {
-            drawBmp("/heart_on.bmp", LIKEBUTTON_X, LIKEBUTTON_Y);
+            drawBmp("/heart_on.bmp", layout.likeButton.x, layout.likeButton.y);
         }
         else {
-            drawBmp("/heart.bmp", LIKEBUTTON_X, LIKEBUTTON_Y);
+            drawBmp("/heart.bmp", layout.likeButton.x, layout.likeButton.y);
         }
         if (cmdDislike) {
-            drawBmp("/thumbdown_on.bmp", DISLIKEBUTTON_X, DISLIKEBUTTON_Y);
+            drawBmp("/thumbdown_on.bmp", layout.dislikeButton.x, layout.dislikeButton.y);
         }
         else {
-            drawBmp("/thumbdown.bmp", DISLIKEBUTTON_X, DISLIKEBUTTON_Y);
+            drawBmp("/thumbdown.bmp", layout.dislikeButton.x, layout.dislikeButton.y);
         }
 
         if (cmdPlaying) {
-            drawBmp("/pause.bmp", PLAYPAUSEBUTTON_X, PLAYPAUSEBUTTON_Y);
+            drawBmp("/pause.bmp", layout.playPauseButton.x, layout.playPauseButton.y);
         }
         else {
-            drawBmp("/play.bmp", PLAYPAUSEBUTTON_X, PLAYPAUSEBUTTON_Y);
+            drawBmp("/play.bmp", layout.playPauseButton.x, layout.playPauseButton.y);
         }
 
-        drawBmp("/skip.bmp", SKIPBUTTON_X, SKIPBUTTON_Y);
+        drawBmp("/skip.bmp", layout.skipButton.x, layout.skipButton.y);
     }
     else {
         // Clear buttons
-        tft.fillRect(LIKEBUTTON_X, LIKEBUTTON_Y, 36, 36, TFT_BLACK);
-        tft.fillRect(DISLIKEBUTTON_X, DISLIKEBUTTON_Y, 36, 36, TFT_BLACK);
-        tft.fillRect(PLAYPAUSEBUTTON_X, PLAYPAUSEBUTTON_Y, 36, 36, TFT_BLACK);
-        tft.fillRect(SKIPBUTTON_X, SKIPBUTTON_Y, 36, 36, TFT_BLACK);
+        tft.fillRect(layout.likeButton.x, layout.likeButton.y, layout.likeButton.w, layout.likeButton.h, TFT_BLACK);
+        tft.fillRect(layout.dislikeButton.x, layout.dislikeButton.y, layout.dislikeButton.w, layout.dislikeButton.h, TFT_BLACK);
+        tft.fillRect(layout.playPauseButton.x, layout.playPauseButton.y, layout.playPauseButton.w, layout.playPauseButton.h, TFT_BLACK);
+        tft.fillRect(layout.skipButton.x, layout.skipButton.y, layout.skipButton.w, layout.skipButton.h, TFT_BLACK);
     }
 }
 
@@ -1599,20 +2628,87 @@ void sendCommand(String command) {
 }
 
 
-void sendVolUpdate(int zone)
+// Knob position on a volume bar for a volume in percent. Both bars have the same span.
+int volumeKnobX(float volPercent)
 {
-    // Send volume update to API, but only one update per second so we don't spam it
-    int volDb = 0;
-    if (zone == 1) { volDb = (int)(volPercent1 * 0.79 - 79); } // Convert to proper AmpliPi number (-79 to 0)
-    else if (zone == 2) { volDb = (int)(volPercent2 * 0.79 - 79); } // Convert to proper AmpliPi number (-79 to 0)
+    return layout.volBar1.x + int(volPercent * layout.volBar1.w / 100);
+}
 
-    String payload = "{\"vol\": " + String(volDb) + "}";
-    Serial.println(payload);
-    bool result = patchAPI("zones/" + String(amplipiZone1), payload);
-    Serial.print("sendVolUpdate result: ");
-    Serial.println(result);
+// Volume in percent for a touch at x
+float volumePercentAt(int x)
+{
+    float volPercent = float(x - layout.volBar1.x) * 100 / layout.volBar1.w;
+    if (volPercent < 0) { volPercent = 0; }
+    if (volPercent > 100) { volPercent = 100; }
+    return volPercent;
+}
+
+// Repaint columns x0 to x1 (exclusive) of a volume bar, over the height of the knob. The knob itself isn't drawn.
+void drawVolumeColumns(int barY, int x0, int x1, int knobX, bool muted)
+{
+    if (x0 < layout.volBar1.x - VOLKNOB_R) { x0 = layout.volBar1.x - VOLKNOB_R; }
+    if (x1 > layout.screen.w) { x1 = layout.screen.w; }
+    if (x1 <= x0) { return; }
+
+    int top = barY - VOLKNOB_TOP;
+    tft.fillRect(x0, top, x1 - x0, VOLKNOB_TOP, TFT_BLACK);                                          // Above the bar
+    tft.fillRect(x0, barY + VOLBAR_H, x1 - x0, VOLKNOB_SIZE - VOLKNOB_TOP - VOLBAR_H, TFT_BLACK);   // Below the bar
+
+    // Bar rows: blue left of the knob unless muted, grey to the end of the bar, black past it
+    int blueEnd = muted ? layout.volBar1.x : knobX;
+    int greyEnd = layout.volBar1.x + layout.volBar1.w;
+    int x = x0;
+    if (x < layout.volBar1.x) {
+        int w = min(x1, layout.volBar1.x) - x;
+        tft.fillRect(x, barY, w, VOLBAR_H, TFT_BLACK);
+        x += w;
+    }
+    if (x < x1 && x < blueEnd) {
+        int w = min(x1, blueEnd) - x;
+        tft.fillRect(x, barY, w, VOLBAR_H, BLUE);
+        x += w;
+    }
+    if (x < x1 && x < greyEnd) {
+        int w = min(x1, greyEnd) - x;
+        tft.fillRect(x, barY, w, VOLBAR_H, GREY);
+        x += w;
+    }
+    if (x < x1) {
+        tft.fillRect(x, barY, x1 - x, VOLBAR_H, TFT_BLACK);
+    }
+    benchPixels((x1 - x0) * VOLKNOB_SIZE);
 }
 
+// Draw the knob. In the middle of the bar the knob and the bar around it look the same wherever it is,
+// so a sprite rendered once is pushed. Near the ends the footprint is repainted and the circle drawn.
+void drawVolumeKnob(int barY, int knobX, bool muted)
+{
+    uint16_t color = muted ? GREY : BLUE;
+    bool inside = (knobX - VOLKNOB_R >= layout.volBar1.x) && (knobX + VOLKNOB_R < layout.volBar1.x + layout.volBar1.w);
+
+    if (inside && knobSpriteColor != color) {
+        if (knobSpriteColor < 0 && knobSprite.createSprite(VOLKNOB_SIZE, VOLKNOB_SIZE) == NULL) {
+            inside = false; // No memory for the sprite, draw it directly
+        }
+        else {
+            knobSprite.fillSprite(TFT_BLACK);
+            knobSprite.fillRect(0, VOLKNOB_TOP, VOLKNOB_SIZE, VOLBAR_H, GREY);
+            if (!muted) { knobSprite.fillRect(0, VOLKNOB_TOP, VOLKNOB_R, VOLBAR_H, BLUE); }
+            knobSprite.fillCircle(VOLKNOB_R, VOLKNOB_R, VOLKNOB_R, color);
+            knobSpriteColor = color;
+        }
+    }
+
+    if (inside) {
+        knobSprite.pushSprite(knobX - VOLKNOB_R, barY - VOLKNOB_TOP);
+        benchPixels(VOLKNOB_SIZE * VOLKNOB_SIZE);
+    }
+    else {
+        drawVolumeColumns(barY, knobX - VOLKNOB_R, knobX + VOLKNOB_R + 1, knobX, muted);
+        tft.fillCircle(knobX, (barY + 2), VOLKNOB_R, color);
+        benchPixels(VOLKNOB_SIZE * VOLKNOB_SIZE);
+    }
+}
 
 void drawVolume(int x, int zone)
 {
@@ -1623,104 +2719,60 @@ void drawVolume(int x, int zone)
 
     Serial.print("Drawing volume bar");
 
-    // Bring to 100% if it's close to the screen edge
-    if (x > (TFT_WIDTH - 55)) { x = TFT_WIDTH - 40; }
+    // Keep the knob on the bar
+    if (x < layout.volBar1.x) { x = layout.volBar1.x; }
+    if (x > layout.volBar1.right()) { x = layout.volBar1.right(); }
 
-    if (amplipiZone2Enabled) {
-        // Two Zone Mode
-        if (zone == 1) {
-            // Zone 1
-            tft.fillRect(VOLBARZONE_X, VOLBARZONE1_Y, VOLBARZONE_W, VOLBARZONE_H, TFT_BLACK); // Clear area first
-
-            // Volume control bar
-            tft.fillRect(VOLBAR_X, VOLBAR1_Y, VOLBAR_W, VOLBAR_H, GREY);           // Grey bar
-            if (muteZone1) {
-                // Muted
-                tft.fillCircle(x, (VOLBAR1_Y + 2), 8, GREY);                       // Circle marker
-            }
-            else {
-                // Unmuted
-                tft.fillRect(VOLBAR_X, VOLBAR1_Y, (x - VOLBAR_X), VOLBAR_H, BLUE); // Blue active bar
-                tft.fillCircle(x, (VOLBAR1_Y + 2), 8, BLUE);                       // Circle marker
-            }
-            updateVol1 = false;
+    // In one zone mode zone 1 is shown on the lower bar
+    int bar = (amplipiZone2Enabled && zone == 1) ? 0 : 1;
+    int barY = (bar == 0) ? layout.volBar1.y : layout.volBar2.y;
+    bool muted = (amplipiZone2Enabled && zone == 2) ? muteZone2 : muteZone1;
+    VolumeBar &shown = volumeBars[bar];
+
+    if (shown.drawn && shown.muted == muted) {
+        // Only the columns the knob has left need repainting, then the knob goes on top
+        if (x > shown.knobX) {
+            drawVolumeColumns(barY, shown.knobX - VOLKNOB_R, min(x - VOLKNOB_R, shown.knobX + VOLKNOB_R + 1), x, muted);
         }
-        else if (zone == 2) {
-            // Zone 2
-            tft.fillRect(VOLBARZONE_X, VOLBARZONE2_Y, VOLBARZONE_W, VOLBARZONE_H, TFT_BLACK); // Clear area first
-
-            // Volume control bar
-            tft.fillRect(VOLBAR_X, VOLBAR2_Y, VOLBAR_W, VOLBAR_H, GREY);           // Grey bar
-            if (muteZone2) {
-                // Muted
-                tft.fillCircle(x, (VOLBAR2_Y + 2), 8, GREY);                       // Circle marker
-            }
-            else {
-                // Unmuted
-                tft.fillRect(VOLBAR_X, VOLBAR2_Y, (x - VOLBAR_X), VOLBAR_H, BLUE); // Blue active bar
-                tft.fillCircle(x, (VOLBAR2_Y + 2), 8, BLUE);                       // Circle marker
-            }
-            updateVol2 = false;
+        else if (x < shown.knobX) {
+            drawVolumeColumns(barY, max(x + VOLKNOB_R + 1, shown.knobX - VOLKNOB_R), shown.knobX + VOLKNOB_R + 1, x, muted);
         }
+        if (x != shown.knobX) { drawVolumeKnob(barY, x, muted); }
     }
     else {
-        // One Zone Mode
-        tft.fillRect(VOLBARZONE_X, VOLBARZONE2_Y, VOLBARZONE_W, VOLBARZONE_H, TFT_BLACK);   // Clear area first
-
-        // Volume control bar
-        tft.fillRect(VOLBAR_X, VOLBAR2_Y, VOLBAR_W, VOLBAR_H, GREY);               // Grey bar
-        if (muteZone1) {
-            // Muted
-            tft.fillCircle(x, (VOLBAR2_Y + 2), 8, GREY);
+        if (bar == 0) {
+            tft.fillRect(layout.volZone1.x, layout.volZone1.y, layout.volZone1.w, layout.volZone1.h, TFT_BLACK); // Clear area first
+            volumeBars[1].drawn = false; // The upper zone reaches over the lower bar
         }
         else {
-            tft.fillRect(VOLBAR_X, VOLBAR2_Y, (x - VOLBAR_X), VOLBAR_H, BLUE);    // Blue active bar
-            tft.fillCircle(x, (VOLBAR2_Y + 2), 8, BLUE);
+            tft.fillRect(layout.volZone2.x, layout.volZone2.y, layout.volZone2.w, layout.volZone2.h, TFT_BLACK); // Clear area first
         }
-        updateVol1 = false;
-        updateVol2 = false;
-    }
-
-}
 
+        benchPixels(layout.volZone1.w * layout.volZone1.h);
 
-void sendMuteUpdate(int zone)
-{
-    // Send volume update to API, but only one update per second so we don't spam it
-    String payload;
-
-    if (zone == 1)
-    {
-        if (muteZone1) {
-            payload = "{\"mute\": true}";
-        }
-        else {
-            payload = "{\"mute\": false}";
-        }
-        bool result = patchAPI("zones/" + String(amplipiZone1), payload);
-        if (DEBUGAPIREQ)
-        {
-            Serial.print("sendMuteUpdate result: ");
-            Serial.println(result);
+        // Volume control bar
+        tft.fillRect(layout.volBar1.x, barY, layout.volBar1.w, VOLBAR_H, GREY);                 // Grey bar
+        benchPixels(layout.volBar1.w * VOLBAR_H * 2);
+        if (!muted) {
+            tft.fillRect(layout.volBar1.x, barY, (x - layout.volBar1.x), VOLBAR_H, BLUE);       // Blue active bar
         }
+        drawVolumeKnob(barY, x, muted);                                           // Circle marker
     }
-    else if (zone == 2)
-    {
-        if (muteZone2) {
-            payload = "{\"mute\": true}";
-        }
-        else {
-            payload = "{\"mute\": false}";
-        }
-        bool result = patchAPI("zones/" + String(amplipiZone2), payload);
-        if (DEBUGAPIREQ)
-        {
-            Serial.print("sendMuteUpdate result: ");
-            Serial.println(result);
-        }
+    shown.drawn = true;
+    shown.muted = muted;
+    shown.knobX = x;
+
+    if (amplipiZone2Enabled) {
+        if (zone == 1) { updateVol1 = false; }
+        else if (zone == 2) { updateVol2 = false; }
+    }
+    else {
+        updateVol1 = false;
+        updateVol2 = false;
     }
 }
 
+
 void drawMuteBtn(int zone)
 {
     if (amplipiZone2Enabled && !updateMute1 && !updateMute2)
@@ -1743,15 +2795,15 @@ void drawMuteBtn(int zone)
     if (amplipiZone2Enabled) {
         // Two Zone Mode
         if (zone == 1) {
-            tft.fillRect(MUTE_X, MUTE1_Y, MUTE_W, MUTE_H, TFT_BLACK); // Upper section
+            tft.fillRect(layout.mute1.x, layout.mute1.y, layout.mute1.w, layout.mute1.h, TFT_BLACK); // Upper section
         }
         else if (zone == 2) {
-            tft.fillRect(MUTE_X, MUTE2_Y, MUTE_W, MUTE_H, TFT_BLACK); // Lower section
+            tft.fillRect(layout.mute2.x, layout.mute2.y, layout.mute2.w, layout.mute2.h, TFT_BLACK); // Lower section
         }
     }
     else {
         // One Zone Mode, lower section
-        tft.fillRect(MUTE_X, MUTE2_Y, MUTE_W, MUTE_H, TFT_BLACK);
+        tft.fillRect(layout.mute2.x, layout.mute2.y, layout.mute2.w, layout.mute2.h, TFT_BLACK);
     }
 
     // Mute/unmute button
@@ -1759,21 +2811,21 @@ void drawMuteBtn(int zone)
         // Two Zone Mode
         if (zone == 1) {
             // Upper section
-            if (muteZone1) { drawBmp("/volume_off.bmp", MUTE_X, MUTE1_Y); }
-            else { drawBmp("/volume_up.bmp", MUTE_X, MUTE1_Y); }
+            if (muteZone1) { drawBmp("/volume_off.bmp", layout.mute1.x, layout.mute1.y); }
+            else { drawBmp("/volume_up.bmp", layout.mute1.x, layout.mute1.y); }
             updateMute1 = false;
         }
         else if (zone == 2) {
             // Lower section
-            if (muteZone2) { drawBmp("/volume_off.bmp", MUTE_X, MUTE2_Y); }
-            else { drawBmp("/volume_up.bmp", MUTE_X, MUTE2_Y); }
+            if (muteZone2) { drawBmp("/volume_off.bmp", layout.mute2.x, layout.mute2.y); }
+            else { drawBmp("/volume_up.bmp", layout.mute2.x, layout.mute2.y); }
             updateMute2 = false;
         }
     }
     else {
         // One Zone Mode, lower section
-        if (muteZone1) { drawBmp("/volume_off.bmp", MUTE_X, MUTE2_Y); }
-        else { drawBmp("/volume_up.bmp", MUTE_X, MUTE2_Y); }
+        if (muteZone1) { drawBmp("/volume_off.bmp", layout.mute2.x, layout.mute2.y); }
+        else { drawBmp("/volume_up.bmp", layout.mute2.x, layout.mute2.y); }
         updateMute1 = false;
         Serial.println("Disabling updateMute1.");
     }
@@ -1781,190 +2833,325 @@ void drawMuteBtn(int zone)
 }
 
 
-// Split a string by a separator
-String getValue(String data, char separator, int index)
+// Mute and volume changes are shown straight away and sent to the AmpliPi by a background task, so the
+// controls never wait on the network. Each change is tagged with a sequence number. While it's on its way,
+// and for polls that started before it was answered, the polled value of that field is ignored so a stale
+// poll can't flick the control back. A change that fails is rolled back to what the AmpliPi last reported.
+enum ZoneField : uint8_t {
+    FIELD_MUTE,
+    FIELD_VOL
+};
+
+struct ZoneIntent {
+    uint32_t seq;       // Latest change sent for this field
+    bool pending;       // Changed on screen, not answered yet
+    uint32_t changedAt; // stateSeq when it was last sent or answered
+    bool known;         // confirmed holds a value from the AmpliPi
+    int confirmed;      // Last value the AmpliPi reported or accepted. Mute 0 or 1, volume in dB
+};
+
+struct ZoneCommand {
+    uint32_t seq;
+    uint8_t zone;       // 1 or 2
+    uint8_t field;
+    int value;
+    int httpCode;       // Filled in by the command task
+    char request[24];
+};
+
+#define COMMAND_SUPERSEDED 0 // httpCode of a change skipped because a newer one for the same field was queued
+#define COMMAND_DROPPED 1    // httpCode of a change the command queue had no room for. Not an HTTP status, and not a network error.
+
+ZoneIntent zoneIntents[2][2] = {};
+uint32_t intentSeq = 0; // Last sequence number given to a change
+uint32_t stateSeq = 0;  // Bumped whenever a change is sent or answered, polls note it when they start
+QueueHandle_t commandQueue = NULL;
+QueueHandle_t commandResults = NULL;
+TaskHandle_t commandTask = NULL;
+
+// Convert to and from the AmpliPi volume (-79 to 0 dB)
+int volDbFromPercent(float volPercent)
 {
-    int found = 0;
-    int strIndex[] = {0, -1};
-    int maxIndex = data.length() - 1;
+    return (int)(volPercent * 0.79 - 79);
+}
 
-    for (int i = 0; i <= maxIndex && found <= index; i++)
-    {
-        if (data.charAt(i) == separator || i == maxIndex)
-        {
-            found++;
-            strIndex[0] = strIndex[1] + 1;
-            strIndex[1] = (i == maxIndex) ? i + 1 : i;
-        }
+float volPercentFromDb(int vol)
+{
+    if (vol < 0) {
+        return vol / 0.79 + 100;
     }
-    return found > index ? data.substring(strIndex[0], strIndex[1]) : "";
+    return 100;
 }
 
-
-void getZone()
+// Background task that sends queued changes and hands the results back to loop()
+void commandLoop(void *parameter)
 {
-    // Multiply the new volume percent by the screen width minus 80 and add 45 pixels (offset for the mute button) to get the x coord
-    float volBarWidth = (TFT_WIDTH - 80) / 100; // 1.6 for 240px screen, 2.4 for 320px screen.
-
-    if (amplipiZone2Enabled) {
-        // Two Zone Mode
-
-        // Zone 1
-        String json = requestAPI("zones/" + String(amplipiZone1));
-        DynamicJsonDocument ampSourceStatus(1000); // DynamicJsonDocument<N> allocates memory on the heap
-        DeserializationError error = deserializeJson(ampSourceStatus, json); // Deserialize the JSON document
-
-        // Test if parsing succeeds.
-        if (error)
-        {
-            Serial.print(F("getZone() (2 zones, zone 1) deserializeJson() failed: "));
-            Serial.println(error.f_str());
-        }
+    ZoneCommand command;
+    for (;;) {
+        xQueueReceive(commandQueue, &command, portMAX_DELAY);
 
-        // Update mute if data from API has changed
-        bool currentMute1 = ampSourceStatus["mute"];
-        if (currentMute1 != muteZone1) {
-            muteZone1 = currentMute1;
-            updateMute1 = true;
-            updateVol1 = true;
-        }
-        drawMuteBtn(1);
-
-        // Update volume bar if data from API has changed
-        int currentVol = ampSourceStatus["vol"];
-        float newVolPercent1;
-        if (currentVol < 0) {
-            newVolPercent1 = currentVol / 0.79 + 100; // Convert from AmpliPi number (-79 to 0) to percent
+        // Only the latest change to a field matters, skip ones that have already been overtaken
+        if (command.seq != zoneIntents[command.zone - 1][command.field].seq) {
+            command.httpCode = COMMAND_SUPERSEDED;
         }
         else {
-            newVolPercent1 = 100;
+            String payload;
+            if (command.field == FIELD_MUTE) {
+                payload = command.value ? "{\"mute\": true}" : "{\"mute\": false}";
+            }
+            else {
+                payload = "{\"vol\": " + String(command.value) + "}";
+            }
+            command.httpCode = sendPatch(String(command.request), payload);
         }
+        xQueueSend(commandResults, &command, portMAX_DELAY);
+    }
+}
 
-        if (volPercent1 != newVolPercent1) {
-            volPercent1 = newVolPercent1;
-            updateVol1 = true;
-        }
-        Serial.println("Calling drawVolume (1 of 2)");
-        drawVolume(int((volPercent1 * volBarWidth) + 45), 1);
+void commandBegin()
+{
+    commandQueue = xQueueCreate(COMMAND_QUEUE_LEN, sizeof(ZoneCommand));
+    commandResults = xQueueCreate(COMMAND_QUEUE_LEN, sizeof(ZoneCommand));
+    if (commandQueue == NULL || commandResults == NULL) {
+        return;
+    }
+    xTaskCreatePinnedToCore(commandLoop, "command", 6144, NULL, 1, &commandTask, 0);
+}
 
-        // Zone 2
-        String json2 = requestAPI("zones/" + String(amplipiZone2));
-        DynamicJsonDocument ampSourceStatus2(1000); // DynamicJsonDocument<N> allocates memory on the heap
-        DeserializationError error2 = deserializeJson(ampSourceStatus2, json2); // Deserialize the JSON document
+// Whether a poll that started at pollSeq may overwrite a field
+bool pollApplies(const ZoneIntent &intent, uint32_t pollSeq)
+{
+    return !intent.pending && intent.changedAt <= pollSeq;
+}
 
-        // Test if parsing succeeds.
-        if (error2)
-        {
-            Serial.print(F("getZone() (2 zones, zone 2) deserializeJson() failed: "));
-            Serial.println(error2.f_str());
-        }
+// Put a zone back to what the AmpliPi last reported and redraw it
+void rollbackZone(int zone, ZoneField field)
+{
+    ZoneIntent &intent = zoneIntents[zone - 1][field];
+    if (!intent.known || (field == FIELD_VOL && volDragZone == zone)) {
+        return; // Never reported, or the finger is still on the bar and a newer change will follow
+    }
 
-        // Update mute if data from API has changed
-        bool currentMute2 = ampSourceStatus2["mute"];
-        if (currentMute2 != muteZone2) {
-            muteZone2 = currentMute2;
-            updateMute2 = true;
-            updateVol2 = true;
-        }
-        drawMuteBtn(2);
+    bool &muteZone = (zone == 2) ? muteZone2 : muteZone1;
+    float &volPercent = (zone == 2) ? volPercent2 : volPercent1;
+    if (field == FIELD_MUTE) {
+        muteZone = intent.confirmed;
+        if (zone == 2) { updateMute2 = true; } else { updateMute1 = true; }
+    }
+    else {
+        volPercent = volPercentFromDb(intent.confirmed);
+    }
+    if (zone == 2) { updateVol2 = true; } else { updateVol1 = true; }
 
-        // Update volume bar if data from API has changed
-        int currentVol2 = ampSourceStatus2["vol"];
-        float newVolPercent2;
-        if (currentVol2 < 0) {
-            newVolPercent2 = currentVol2 / 0.79 + 100; // Convert from AmpliPi number (-79 to 0) to percent
-        }
-        else {
-            newVolPercent2 = 100;
-        }
-        
-        if (volPercent2 != newVolPercent2) {
-            volPercent2 = newVolPercent2;
-            updateVol2 = true;
-        }
-        Serial.println("Calling drawVolume (2 of 2)");
-        drawVolume(int((volPercent2 * volBarWidth) + 45), 2); // Multiply by 1.5 (150px) and add 40 pixels to give it the x coord
+    if (metadata_refresh) {
+        drawMuteBtn(zone);
+        drawVolume(volumeKnobX(volPercent), zone);
+    }
+}
+
+// A change has been answered. Call with the display held.
+void commandFinished(const ZoneCommand &command)
+{
+    ZoneIntent &intent = zoneIntents[command.zone - 1][command.field];
+    if (command.seq != intent.seq) {
+        return; // A newer change to the same field is on its way
+    }
+    intent.pending = false;
+    intent.changedAt = ++stateSeq;
+
+    if (command.httpCode == HTTP_CODE_OK) {
+        intent.confirmed = command.value;
+        intent.known = true;
+        if (inWarning) { clearWarning(); }
+        return;
+    }
+
+    if (command.httpCode == COMMAND_DROPPED) {
+        Serial.println("Zone change dropped, the command queue is full. Rolling back.");
+    }
+    else {
+        Serial.print("Zone change failed, rolling back. Code: ");
+        Serial.println(command.httpCode);
+    }
+    rollbackZone(command.zone, (ZoneField)command.field);
+    if (inWarning) { clearWarning(); }
+    if (command.httpCode < 0) {
+        drawWarning("Unable to access AmpliPi");
+        requestResolve(); // The AmpliPi may have a new address
     }
     else {
-        // One Zone Mode
-        String json = requestAPI("zones/" + String(amplipiZone1));
-        DynamicJsonDocument ampSourceStatus(1000); // DynamicJsonDocument<N> allocates memory on the heap
-        DeserializationError error = deserializeJson(ampSourceStatus, json); // Deserialize the JSON document
+        drawWarning(command.field == FIELD_MUTE ? "Mute change failed" : "Volume change failed");
+    }
+}
+
+// Apply the answers the command task has collected
+void applyCommandResults()
+{
+    ZoneCommand command;
+    while (commandResults != NULL && xQueueReceive(commandResults, &command, 0) == pdTRUE) {
+        commandFinished(command);
+    }
+}
 
-        // Test if parsing succeeds.
-        if (error)
+// Record a change made on screen and queue it for the AmpliPi
+void sendZoneIntent(int zone, ZoneField field, int value)
+{
+    ZoneCommand command;
+    command.seq = ++intentSeq;
+    command.zone = zone;
+    command.field = field;
+    command.value = value;
+    command.httpCode = -1;
+    snprintf(command.request, sizeof(command.request), "zones/%s", (zone == 2) ? amplipiZone2 : amplipiZone1);
+
+    ZoneIntent &intent = zoneIntents[zone - 1][field];
+    intent.seq = command.seq;
+    intent.pending = true;
+    intent.changedAt = ++stateSeq;
+
+    if (commandQueue == NULL || xQueueSend(commandQueue, &command, 0) != pdTRUE) {
+        // Nothing can take it, fail it straight away. The network may be fine, so no re-resolve.
+        command.httpCode = COMMAND_DROPPED;
+        commandFinished(command);
+    }
+}
+
+void sendVolUpdate(int zone)
+{
+    sendZoneIntent(zone, FIELD_VOL, volDbFromPercent((zone == 2) ? volPercent2 : volPercent1));
+}
+
+void sendMuteUpdate(int zone)
+{
+    sendZoneIntent(zone, FIELD_MUTE, (zone == 2) ? muteZone2 : muteZone1);
+}
+
+
+// Split a string by a separator
+String getValue(String data, char separator, int index)
+{
+    int found = 0;
+    int strIndex[] = {0, -1};
+    int maxIndex = data.length() - 1;
+
+    for (int i = 0; i <= maxIndex && found <= index; i++)
+    {
+        if (data.charAt(i) == separator || i == maxIndex)
         {
-            Serial.print(F("getZone() (1 zone) deserializeJson() failed: "));
-            Serial.println(error.f_str());
+            found++;
+            strIndex[0] = strIndex[1] + 1;
+            strIndex[1] = (i == maxIndex) ? i + 1 : i;
         }
+    }
+    return found > index ? data.substring(strIndex[0], strIndex[1]) : "";
+}
 
-        // Update mute if data from API has changed
-        bool currentMute = ampSourceStatus["mute"];
-        if (currentMute != muteZone1) {
-            muteZone1 = currentMute;
-            updateMute1 = true;
-            updateVol1 = true;
-            Serial.print("Updating mute and volume. currentMute:");
-            Serial.println(currentMute);
-            Serial.print("muteZone1:");
-            Serial.println(muteZone1);
-        }
-        drawMuteBtn(1);
 
-        // Update volume bar if data from API has changed
-        int currentVol = ampSourceStatus["vol"];
-        float newVolPercent1;
-        if (currentVol < 0) {
-            newVolPercent1 = currentVol / 0.79 + 100; // Convert from AmpliPi number (-79 to 0) to percent
-        }
-        else {
-            newVolPercent1 = 100;
+// Take a zone's mute and volume from a poll that started at pollSeq. Fields with a change on its way are left as shown.
+void applyZoneStatus(int zone, JsonVariant status, uint32_t pollSeq)
+{
+    bool &muteZone = (zone == 2) ? muteZone2 : muteZone1;
+    float &volPercent = (zone == 2) ? volPercent2 : volPercent1;
+    bool &updateMute = (zone == 2) ? updateMute2 : updateMute1;
+    bool &updateVol = (zone == 2) ? updateVol2 : updateVol1;
+    ZoneIntent &muteIntent = zoneIntents[zone - 1][FIELD_MUTE];
+    ZoneIntent &volIntent = zoneIntents[zone - 1][FIELD_VOL];
+
+    // Update mute if data from API has changed
+    bool currentMute = status["mute"];
+    if (pollApplies(muteIntent, pollSeq)) {
+        muteIntent.confirmed = currentMute;
+        muteIntent.known = true;
+        if (currentMute != muteZone) {
+            muteZone = currentMute;
+            updateMute = true;
+            snapshotDirty = true;
+            updateVol = true;
         }
+    }
 
-        if (volPercent1 != newVolPercent1) {
-            volPercent1 = newVolPercent1;
-            updateVol1 = true;
-            Serial.print("Updating volume. volPercent1:");
-            Serial.println(volPercent1);
-            Serial.print("newVolPercent1:");
-            Serial.println(newVolPercent1);
+    // Update volume bar if data from API has changed
+    int currentVol = status["vol"];
+    if (pollApplies(volIntent, pollSeq) && volDragZone != zone) {
+        volIntent.confirmed = currentVol;
+        volIntent.known = true;
+        float newVolPercent = volPercentFromDb(currentVol);
+        if (volPercent != newVolPercent) {
+            volPercent = newVolPercent;
+            updateVol = true;
+            snapshotDirty = true;
         }
-        Serial.println("Calling drawVolume (1 of 1)");
-        drawVolume(int((volPercent1 * volBarWidth) + 45), 1); // Multiply by 1.5 (150px) and add 40 pixels to give it the x coord
     }
-
 }
 
+// Draw a zone's mute button and volume bar, if they've changed
+void drawZone(int zone)
+{
+    drawMuteBtn(zone);
+    drawVolume(volumeKnobX((zone == 2) ? volPercent2 : volPercent1), zone);
+}
 
-// Re-draw metadata, for example after source select is canceled
-void drawMetadata()
+// Read one zone's mute and volume from the AmpliPi
+void getZoneStatus(int zone)
 {
-    String displaySong;
-    String displayArtist;
+    uint32_t pollSeq = stateSeq;
+    RefreshJsonDocument ampSourceStatus(1000);
+    DeserializationError error = requestAPI(arenaPrintf(refreshArena, "zones/%s", (zone == 2) ? amplipiZone2 : amplipiZone1), ampSourceStatus);
 
-    if (currentSong.length() >= (TITLE_LEN + 1)) {
-        displaySong = currentSong.substring(0,TITLE_LEN) + "...";
+    // Test if parsing succeeds. If not, keep what's shown rather than showing an empty status.
+    if (error)
+    {
+        Serial.print(F("getZone() (zone "));
+        Serial.print(zone);
+        Serial.print(F(") deserializeJson() failed: "));
+        Serial.println(error.f_str());
     }
-    else {
-        displaySong = currentSong;
+    else
+    {
+        applyZoneStatus(zone, ampSourceStatus.as<JsonVariant>(), pollSeq);
     }
+    drawZone(zone);
+}
 
-    if (currentArtist.length() >= (ARTIST_LEN + 1)) {
-        displayArtist = currentArtist.substring(0,ARTIST_LEN) + "...";
+void getZone()
+{
+    getZoneStatus(1);
+    if (amplipiZone2Enabled) {
+        // Two Zone Mode
+        getZoneStatus(2);
     }
-    else {
-        displayArtist = currentArtist;
+}
+
+
+// Re-draw metadata, for example after source select is canceled
+void drawMetadata()
+{
+    static bool linesReady = false;
+    if (!linesReady) {
+        textLineBegin(songLine, &tft, FSSB12, layout.metaText.w, METALINE_H, TFT_WHITE, TFT_BLACK); // Bold font
+        textLineBegin(artistLine, &tft, FSS12, layout.metaText.w, METALINE_H, TFT_WHITE, TFT_BLACK);
+        marqueeAdd(songLine); // Long titles scroll instead of being cut
+        linesReady = true;
+    }
+    else if (songLine.w != layout.metaText.w) {
+        // The screen was rotated
+        textLineResize(songLine, layout.metaText.w);
+        textLineResize(artistLine, layout.metaText.w);
     }
 
     Serial.println("Refreshing metadata on screen");
 
-    tft.setTextDatum(TC_DATUM);
-    tft.setFreeFont(FSSB12); // Bold font
-    tft.fillRect(METATEXT_X, METATEXT_Y, METATEXT_W, METATEXT_H, TFT_BLACK); // Clear metadata area first
-    tft.drawString(displaySong, (TFT_WIDTH / 2), (METATEXT_Y + 5), GFXFF);   // Center Middle
-    tft.setFreeFont(FSS12);
-    tft.fillRect(20, (METATEXT_Y + 32), (METATEXT_W - 40), 1, GREY);         // Seperator between song and artist
-    tft.drawString(displayArtist, (TFT_WIDTH / 2), (METATEXT_Y + 40), GFXFF);
+    // Lines are cut to the width they have on this panel, and only rendered again when the text changes
+    textLineSet(songLine, currentSong);
+    textLineSet(artistLine, currentArtist);
+
+    // The lines cover their own rows, so only the gaps around them are cleared
+    tft.fillRect(layout.metaText.x, layout.metaText.y, layout.metaText.w, 5, TFT_BLACK);
+    textLineDraw(songLine, &tft, layout.metaText.x, (layout.metaText.y + 5));              // Center Middle
+    tft.fillRect(layout.metaText.x, (layout.metaText.y + 5 + METALINE_H), layout.metaText.w, (35 - METALINE_H), TFT_BLACK);
+    tft.fillRect((layout.metaText.x + 20), (layout.metaText.y + 32), (layout.metaText.w - 40), 1, GREY); // Seperator between song and artist
+    textLineDraw(artistLine, &tft, layout.metaText.x, (layout.metaText.y + 40));
+    tft.fillRect(layout.metaText.x, (layout.metaText.y + 40 + METALINE_H), layout.metaText.w, (layout.metaText.h - 40 - METALINE_H), TFT_BLACK);
 
     // Draw control buttons for streams that support it
     cmdLike = false;
@@ -1972,7 +3159,20 @@ void drawMetadata()
     drawCommandButtons();
 }
 
-void getSource(String sourceID)
+// Take the stream's name and type from its status
+void applyStreamStatus(JsonVariant stream)
+{
+    currentStreamName = stream["name"].as<String>();
+    if (currentStreamName.length() >= (SRC_NAME_LEN + 1)) {
+        currentStreamName = currentStreamName.substring(0,SRC_NAME_LEN) + "...";
+    }
+
+    currentStreamType = stream["type"].as<String>();
+}
+
+// Show a source's status. stream is the status of the stream playing on it, if the AmpliPi sent it along,
+// otherwise it's requested when the stream changes.
+void applySourceStatus(String sourceID, JsonVariant ampSourceStatus, JsonVariant stream)
 {
     String streamArtist = "";
     String streamAlbum = "";
@@ -1982,23 +3182,6 @@ void getSource(String sourceID)
     String streamID = "";
     String streamName = "";
 
-    String json = requestAPI("sources/" + String(sourceID));
-
-    // DynamicJsonDocument<N> allocates memory on the heap
-    DynamicJsonDocument ampSourceStatus(2000);
-
-    // Deserialize the JSON document
-    DeserializationError error = deserializeJson(ampSourceStatus, json);
-
-    // Test if parsing succeeds.
-    if (error)
-    {
-        Serial.print(F("deserializeJson() failed: "));
-        Serial.println(error.f_str());
-
-        //String errormsg = "Error parsing results from Amplipi API";
-    }
-
     sourceInput = ampSourceStatus["input"].as<String>();
     Serial.print("sourceInput: ");
     Serial.println(sourceInput);
@@ -2024,31 +3207,26 @@ void getSource(String sourceID)
     {
         currentStreamID = streamID;
 
-        String streamJson = requestAPI("streams/" + String(streamID));
-
-        // DynamicJsonDocument<N> allocates memory on the heap
-        DynamicJsonDocument ampStreamStatus(2000);
-
-        // Deserialize the JSON document
-        DeserializationError streamError = deserializeJson(ampStreamStatus, streamJson);
-
-        // Test if parsing succeeds.
-        if (streamError)
-        {
-            Serial.print(F("deserializeJson() failed: "));
-            Serial.println(streamError.f_str());
-
-            //String errormsg = "Error parsing results from Amplipi API";
+        if (!stream.isNull()) {
+            applyStreamStatus(stream);
         }
+        else {
+            RefreshJsonDocument ampStreamStatus(2000);
+            DeserializationError streamError = requestAPI(arenaPrintf(refreshArena, "streams/%s", streamID.c_str()), ampStreamStatus);
 
-        currentStreamName = ampStreamStatus["name"].as<String>();
-        if (currentStreamName.length() >= (SRC_NAME_LEN + 1)) {
-            currentStreamName = currentStreamName.substring(0,SRC_NAME_LEN) + "...";
-        }
+            // Test if parsing succeeds.
+            if (streamError)
+            {
+                Serial.print(F("deserializeJson() failed: "));
+                Serial.println(streamError.f_str());
 
-        currentStreamType = ampStreamStatus["type"].as<String>();
+                //String errormsg = "Error parsing results from Amplipi API";
+            }
+            applyStreamStatus(ampStreamStatus.as<JsonVariant>());
+        }
 
         updateSource = true;
+        snapshotDirty = true;
         drawSource();
     }
     else if (currentStreamID != streamID && streamID == "0") {
@@ -2105,26 +3283,287 @@ void getSource(String sourceID)
         currentSong = streamSong;
         currentStatus = streamStatus;
         drawMetadata();
+        snapshotDirty = true;
     }
 
     // Download and refresh album art if it has changed
+    int aaX, aaY, aaW;
+    albumartBox(&aaX, &aaY, &aaW);
     if (albumArt != currentAlbumArt)
     {
         Serial.println("Album art changed from " + currentAlbumArt + " to " + albumArt);
         currentAlbumArt = albumArt;
         updateAlbumart = true;
-        downloadAlbumart(sourceID);
+        snapshotDirty = true;
+        if (artCacheHas(artKey(albumArt), aaW)) {
+            artFormat = ART_RGB565; // Prefetched, draw it straight from flash
+        }
+        else {
+            downloadAlbumartPreview(sourceID);
+            downloadAlbumart(sourceID);
+        }
         drawAlbumart();
     }
 
+    // Get the next track's art ready, if the stream knows it
+    String nextArt = ampSourceStatus["info"]["next_img_url"].as<String>();
+    if (nextArt != "null" && nextArt.length() > 0 && artFormat == ART_RGB565) {
+        // The prefetch runs later, when "next" may be another track. url_hash makes the AmpliPi answer 404
+        // then, instead of sending art that would be cached under this url's key.
+        uint32_t key = artKey(nextArt);
+        artPrefetch(key, aaW, "sources/" + sourceID + "/image/" + String(aaW)
+            + "?height=" + String(layout.albumArt.h) + "&format=rle565&next=1&url_hash=" + String(key, HEX));
+    }
+
+}
+
+void getSource(String sourceID)
+{
+    RefreshJsonDocument ampSourceStatus(2000);
+    DeserializationError error = requestAPI(arenaPrintf(refreshArena, "sources/%s", sourceID.c_str()), ampSourceStatus);
+
+    // Test if parsing succeeds.
+    if (error)
+    {
+        Serial.print(F("deserializeJson() failed: "));
+        Serial.println(error.f_str());
+
+        //String errormsg = "Error parsing results from Amplipi API";
+    }
+
+    applySourceStatus(sourceID, ampSourceStatus.as<JsonVariant>(), JsonVariant());
+}
+
+// AmpliPis with the touchscreen additions answer one request with everything the main screen shows
+bool controllerRouteAvailable = true;
+
+// Zones shown, as the zones query parameter of the controller routes
+String controllerZones()
+{
+    String zones = String(amplipiZone1);
+    if (amplipiZone2Enabled) {
+        zones += "," + String(amplipiZone2);
+    }
+    return zones;
+}
+
+// Show a controller document, from a request that started at pollSeq
+void applyControllerState(JsonDocument &controllerStatus, uint32_t pollSeq)
+{
+    for (JsonVariant zoneStatus : controllerStatus["zones"].as<JsonArray>()) {
+        int id = zoneStatus["id"];
+        if (id == atoi(amplipiZone1)) {
+            applyZoneStatus(1, zoneStatus, pollSeq);
+        }
+        else if (amplipiZone2Enabled && id == atoi(amplipiZone2)) {
+            applyZoneStatus(2, zoneStatus, pollSeq);
+        }
+    }
+    drawZone(1);
+    if (amplipiZone2Enabled) {
+        drawZone(2);
+    }
+
+    applySourceStatus(String(amplipiSource), controllerStatus["source"], controllerStatus["stream"]);
+}
+
+// Refresh zones and source with one request. Returns false if the AmpliPi doesn't have the controller route.
+bool getControllerState()
+{
+    uint32_t pollSeq = stateSeq;
+    int httpCode = 0;
+    RefreshJsonDocument controllerStatus(3072);
+    DeserializationError error = requestAPI(arenaPrintf(refreshArena, "controller/%s?zones=%s", amplipiSource, controllerZones().c_str()),
+        controllerStatus, &httpCode);
+    if (httpCode == HTTP_CODE_NOT_FOUND) {
+        Serial.println("AmpliPi has no controller route, polling zones and source separately");
+        controllerRouteAvailable = false;
+        return false;
+    }
+    if (httpCode == HTTP_CODE_UNPROCESSABLE_ENTITY) {
+        Serial.println("AmpliPi has no source " + String(amplipiSource) + ", check the settings");
+    }
+    else if (httpCode == HTTP_CODE_OK && error)
+    {
+        // Keep what's shown, the next refresh will try again
+        Serial.print(F("getControllerState() deserialize failed: "));
+        Serial.println(error.f_str());
+    }
+    else if (httpCode == HTTP_CODE_OK) {
+        applyControllerState(controllerStatus, pollSeq);
+    }
+    return true;
+}
+
+// The long poll runs on its own task so loop() keeps handling touches while it waits. Answers are left
+// in a mailbox that loop() empties; only the latest one matters.
+SemaphoreHandle_t changesLock = NULL;
+TaskHandle_t changesTask = NULL;
+DynamicJsonDocument changesStatus(3072);
+uint32_t changesPollSeq = 0; // stateSeq when the request for changesStatus was sent
+bool changesWaiting = false;
+volatile bool changesActive = false; // The AmpliPi is answering long polls
+
+void changesLoop(void *parameter)
+{
+    DynamicJsonDocument controllerStatus(3072);
+    String lastQuery;
+    uint32_t since = 0;
+
+    for (;;) {
+        if (!eth_connected || !hostIPKnown() || !controllerRouteAvailable) {
+            changesActive = false;
+            vTaskDelay(pdMS_TO_TICKS(CHANGES_RETRY_INTERVAL));
+            continue;
+        }
+
+        // Settings may have changed the source or zones, then ask for the whole document again
+        String query = "changes?source=" + String(amplipiSource) + "&zones=" + controllerZones()
+            + "&timeout=" + String(CHANGES_TIMEOUT);
+        if (query != lastQuery) {
+            lastQuery = query;
+            since = 0;
+        }
+        String request = query + "&since=" + String(since);
+
+        HTTPClient http;
+        http.setConnectTimeout(5000);
+        http.setTimeout((CHANGES_TIMEOUT + 5) * 1000);
+        http.begin("http://" + getAmpliPiHostIP() + "/api/" + request);
+        acceptDocument(http);
+
+        uint32_t pollSeq = stateSeq;
+        int httpCode = http.GET();
+        benchRequest();
+
+        DeserializationError error = DeserializationError::EmptyInput;
+        if (httpCode == HTTP_CODE_OK) {
+            error = readDocument(http, controllerStatus);
+        }
+        http.end();
+        traceDocument("GET", request.c_str(), httpCode, controllerStatus);
+
+        if (httpCode == HTTP_CODE_OK && !error) {
+            since = controllerStatus["version"];
+            xSemaphoreTake(changesLock, portMAX_DELAY);
+            changesStatus = controllerStatus;
+            changesPollSeq = pollSeq;
+            changesWaiting = true;
+            xSemaphoreGive(changesLock);
+            changesActive = true;
+        }
+        else if (httpCode == HTTP_CODE_NO_CONTENT) {
+            changesActive = true; // Nothing changed
+        }
+        else {
+            changesActive = false;
+            if (httpCode == HTTP_CODE_NOT_FOUND) {
+                // An older AmpliPi, stay with the timed refresh
+                Serial.println("AmpliPi has no long poll for changes");
+                changesTask = NULL;
+                vTaskDelete(NULL);
+            }
+            vTaskDelay(pdMS_TO_TICKS(CHANGES_RETRY_INTERVAL));
+        }
+        controllerStatus.clear();
+    }
+}
+
+// Start the long poll, or start it again if it stopped because the AmpliPi answered 404
+void changesBegin()
+{
+    if (changesLock == NULL) {
+        changesLock = xSemaphoreCreateMutex();
+        if (changesLock == NULL) {
+            return;
+        }
+    }
+    if (changesTask == NULL) {
+        xTaskCreatePinnedToCore(changesLoop, "changes", 6144, NULL, 1, &changesTask, 0);
+    }
+}
+
+// Show what the long poll brought in. Call with the display held.
+void applyChanges()
+{
+    if (changesLock == NULL || !changesWaiting) {
+        return;
+    }
+    xSemaphoreTake(changesLock, portMAX_DELAY);
+    RefreshJsonDocument controllerStatus(changesStatus.capacity());
+    controllerStatus.set(changesStatus);
+    uint32_t pollSeq = changesPollSeq;
+    changesStatus.clear();
+    changesWaiting = false;
+    xSemaphoreGive(changesLock);
+
+    applyControllerState(controllerStatus, pollSeq);
+}
+
+// Startup screen, shown on the first boot before there is any state to display
+void drawWelcome()
+{
+    tft.setTextDatum(TC_DATUM);
+    tft.setCursor((layout.screen.w / 3) - 15, 40, 2); // center
+    tft.setFreeFont(FSS18);
+
+    tft.print("Ampli");
+    tft.setTextColor(TFT_RED, TFT_BLACK);
+    tft.println("Pi");
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    tft.setFreeFont(FSS12);
+    tft.setCursor((layout.screen.w / 3) - 5, 100, 2); // center
+    tft.println("Welcome");
+    tft.println("");
+
+    tft.setFreeFont(FSS9);
+    tft.drawString("Connecting to network", (layout.screen.w / 2), (layout.screen.h - 20), GFXFF); // Center Middle
+}
+
+// AmpliPi address for the art prefetch task, empty until there is one to talk to
+String prefetchHostIP()
+{
+    if (!eth_connected || !hostIPKnown()) {
+        return "";
+    }
+    return getAmpliPiHostIP();
+}
+
+// Paint the main screen from the state snapshot, without needing the AmpliPi
+void drawCachedState()
+{
+    updateSource = true;
+    updateMute1 = true;
+    updateMute2 = true;
+    updateVol1 = true;
+    updateVol2 = true;
+    int aaX, aaY, aaW;
+    albumartBox(&aaX, &aaY, &aaW);
+    if (artCacheHas(artKey(currentAlbumArt), aaW)) { artFormat = ART_RGB565; }
+    else if (SPIFFS.exists("/albumart.jpg")) { artFormat = ART_JPEG; }
+    updateAlbumart = (currentAlbumArt.length() > 0 && artFormat != ART_NONE);
+
+    drawSource();
+    drawMuteBtn(1);
+    drawVolume(volumeKnobX(volPercent1), 1);
+    if (amplipiZone2Enabled) {
+        drawMuteBtn(2);
+        drawVolume(volumeKnobX(volPercent2), 2);
+    }
+    drawMetadata();
+    drawAlbumart();
 }
 
 void setup() {
     Serial.begin(115200);
     Serial.println("AmpliPi System Startup");
 
-    // Load configuration file
-    loadFileFSConfigFile();
+    displayLock = xSemaphoreCreateMutex();
+    traceBegin();
+    arenaBegin(); // Before anything else takes from the heap
+
+    // Load configuration
+    loadConfig();
 
     newAmplipiZone1 = atoi(amplipiZone1);
     newAmplipiZone2 = atoi(amplipiZone2);
@@ -2139,8 +3578,12 @@ void setup() {
     tft.init();
     Serial.println("Screen initialized");
 
+    // Dimmable backlight
+    powerBegin();
+
     // Set the rotation before we calibrate
     tft.setRotation(screenRotation);
+    applyLayout(screenRotation);
 
     // Wrap test at right and bottom of screen
     tft.setTextWrap(true, true);
@@ -2156,572 +3599,674 @@ void setup() {
     // The decoder must be given the exact name of the rendering function above
     TJpgDec.setCallback(tft_output);
 
+    // Decode on the other core and push blocks with DMA, this replaces the callback when it can be set up
+    jpegBegin();
+    commandBegin();
+    changesBegin();
+
     // Call screen calibration
     //  This also handles formatting the filesystem if it hasn't been formatted yet
     touch_calibrate();
 
-    // clear screen
+    // Replaced by the art cache
+    SPIFFS.remove("/albumart.565");
+    artCacheBegin(prefetchHostIP);
+
     tft.fillScreen(TFT_BLACK);
-    tft.setTextDatum(TC_DATUM);
-    tft.setCursor((TFT_WIDTH / 3) - 15, 40, 2); // center
-    tft.setFreeFont(FSS18);
 
-    tft.print("Ampli");
-    tft.setTextColor(TFT_RED, TFT_BLACK);
-    tft.println("Pi");
-    tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.setFreeFont(FSS12);
-    tft.setCursor((TFT_WIDTH / 3) - 5, 100, 2); // center
-    tft.println("Welcome");
-    tft.println("");
+    // Show the last known state straight away, a live update follows once the network is up
+    if (loadStateSnapshot()) {
+        drawCachedState();
+    }
+    else {
+        drawWelcome();
+        networkScreenShown = true;
+    }
 
     WiFi.onEvent(WiFiEvent);
     ETH.begin();
+    Serial.println("Connecting to network");
 
-    Serial.print("Connecting to network");
-    tft.setFreeFont(FSS9);
-    tft.drawString("Connecting to network", (TFT_WIDTH / 2), (TFT_HEIGHT - 20), GFXFF); // Center Middle
+    // Doesn't wait for the network. The resolver picks up once Ethernet has an address.
+    getAmpliPiIP();
 
-    //while (WiFi.status() != WL_CONNECTED)
-    while (!eth_connected)
-    {
-        Serial.print(".");
-        delay(500);
-    }
-    Serial.println("");
-    Serial.print("Connected to network. Local IP: ");
-    Serial.println(ETH.localIP());
-    
-    tft.fillRect(0, (TFT_HEIGHT - 40), TFT_WIDTH, 40, TFT_BLACK); // Clear area first
-    tft.drawString("Connected. IP address: ", (TFT_WIDTH / 2), (TFT_HEIGHT - 40), GFXFF); // Center Middle
-    tft.drawString(String(ETH.localIP()[0])+"."+String(ETH.localIP()[1])+"."+String(ETH.localIP()[2])+"."+String(ETH.localIP()[3]), (TFT_WIDTH / 2), (TFT_HEIGHT - 20), GFXFF); // Center Middle
-    delay(500);
+    // Touch is sampled in the background from here on
+    touchBegin(&tft, displayLock);
 
-    getAmpliPiIP();
+    // Long titles scroll from a timer
+    marqueeBegin(displayLock);
+}
 
-    // Clear screen
-    tft.fillScreen(TFT_BLACK);
-    tft.setCursor(0, 20, 2);
+// Move a volume bar to where it was touched. The change is sent to the AmpliPi by sendPendingVolume().
+void setVolumeFromTouch(int x, int zone)
+{
+    // A drag can wander past the ends of the bar
+    float volPercent = volumePercentAt(x);
+    x = volumeKnobX(volPercent);
+
+    if (zone == 1) {
+        updateVol1 = true;
+        volPercent1 = volPercent;
+    }
+    else {
+        updateVol2 = true;
+        volPercent2 = volPercent;
+    }
+    drawVolume(x, zone);
+    zoneIntents[zone - 1][FIELD_VOL].pending = true; // Not sent yet, polls leave the knob where the finger put it
+
+    volDragZone = zone;
+    volUpdatePending = true;
 }
 
-/**
- * This is where the touch events and automatic metadata refresh happen.
- * We first check to see what screen we're currently on, then we look for the touch events (buttons, etc) that are available for that screen.
- */
-void loop() {
-    uint16_t x, y;
+// Send the latest volume to the AmpliPi. While dragging this is limited to one update per VOL_SEND_INTERVAL.
+void sendPendingVolume(bool force)
+{
+    static unsigned long lastVolSend = 0;
 
-    // See if there's any touch data for us
-    if (tft.getTouch(&x, &y))
+    if (!volUpdatePending || volDragZone == 0)
+    {
+        return;
+    }
+    if (!force && millis() - lastVolSend < VOL_SEND_INTERVAL)
     {
-        // Draw a block spot to show where touch was calculated to be
-        //tft.fillCircle(x, y, 2, TFT_BLUE);
-        Serial.print("X: ");
-        Serial.print(x);
-        Serial.print(" - Y: ");
-        Serial.println(y);
+        return;
+    }
+    volUpdatePending = false;
+    lastVolSend = millis();
+    sendVolUpdate(volDragZone);
+}
 
-        // Touch screen control
+// What a touch target does when it's touched
+enum TouchAction : uint8_t {
+    ACTION_WAKE,            // Turn the screen back on
+    ACTION_POWER_OFF,
+    ACTION_SHOW_SELECT,     // Back to the main screen
+    ACTION_SHOW_METADATA,   // Full width album art
+    ACTION_SHOW_SOURCES,
+    ACTION_CLOSE,           // Back to the main screen, clearing the main area
+    ACTION_STREAM_COMMAND,  // arg: index into streamCommands
+    ACTION_MUTE,            // arg: volume bar, 1 (upper) or 2 (lower)
+    ACTION_VOLUME,          // arg: volume bar, 1 (upper) or 2 (lower)
+    ACTION_SELECT_SOURCE,
+    ACTION_SOURCE_PAGE,     // arg: -1 previous page, 1 next page
+    ACTION_SHOW_SETTINGS,
+    ACTION_ZONE1_STEP,      // arg: -1 or 1
+    ACTION_ZONE2_STEP,      // arg: -1 or 1
+    ACTION_SOURCE_STEP,     // arg: -1 or 1
+    ACTION_REBOOT,
+    ACTION_RECALIBRATE,
+    ACTION_ROTATE,
+    ACTION_SAVE_SETTINGS,
+    ACTION_SHOW_ABOUT,
+    ACTION_UPDATE,
+    ACTION_SHOW_ZONE        // arg: volume bar, 1 (upper) or 2 (lower)
+};
+
+// When a touch target is active. Some buttons are only drawn in certain states.
+enum TouchCondition : uint8_t {
+    WHEN_ALWAYS,
+    WHEN_PANDORA,     // Stream supports the command buttons
+    WHEN_ZONE2,       // Two zone mode
+    WHEN_PREV_PAGE,   // Source list has a previous page
+    WHEN_NEXT_PAGE,   // Source list has a next page
+    WHEN_UPDATE       // A controller update is available
+};
+
+// Which touch runs a target. Press is immediate; tap waits for the release so the same area can still be dragged or long pressed.
+enum TouchTrigger : uint8_t {
+    ON_PRESS,
+    ON_TAP,
+    ON_LONG_PRESS
+};
+
+// The area is the layout rectangle the target is drawn in, so they can't disagree
+struct TouchTarget {
+    Rect Layout::*area;
+    TouchAction action;
+    int8_t arg;
+    TouchCondition when;
+    TouchTrigger trigger;
+};
+
+const char *streamCommands[] = { "playpause", "next", "love", "ban" };
+
+// Touch targets for each screen. The first matching target wins, so overlapping targets are listed in priority order.
+const TouchTarget selectTargets[] = {
+    { &Layout::playPauseButton, ACTION_STREAM_COMMAND, 0, WHEN_PANDORA, ON_PRESS },
+    { &Layout::skipButton, ACTION_STREAM_COMMAND, 1, WHEN_PANDORA, ON_PRESS },
+    { &Layout::likeButton, ACTION_STREAM_COMMAND, 2, WHEN_PANDORA, ON_PRESS },
+    { &Layout::dislikeButton, ACTION_STREAM_COMMAND, 3, WHEN_PANDORA, ON_PRESS },
+    { &Layout::srcButton, ACTION_SHOW_SOURCES, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::powerButton, ACTION_POWER_OFF, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::albumArt, ACTION_SHOW_METADATA, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::mute1, ACTION_MUTE, 1, WHEN_ZONE2, ON_TAP },
+    { &Layout::mute2, ACTION_MUTE, 2, WHEN_ALWAYS, ON_TAP },
+    { &Layout::mute1, ACTION_SHOW_ZONE, 1, WHEN_ZONE2, ON_LONG_PRESS },
+    { &Layout::mute2, ACTION_SHOW_ZONE, 2, WHEN_ALWAYS, ON_LONG_PRESS },
+    { &Layout::volZone1, ACTION_VOLUME, 1, WHEN_ZONE2, ON_PRESS },
+    { &Layout::volZone2, ACTION_VOLUME, 2, WHEN_ALWAYS, ON_PRESS }
+};
+
+const TouchTarget metadataTargets[] = {
+    { &Layout::screen, ACTION_SHOW_SELECT, 0, WHEN_ALWAYS, ON_PRESS }
+};
+
+const TouchTarget sourceTargets[] = {
+    { &Layout::powerButton, ACTION_POWER_OFF, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::srcButton, ACTION_CLOSE, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::sourceList, ACTION_SELECT_SOURCE, 0, WHEN_ALWAYS, ON_TAP },
+    { &Layout::leftButton, ACTION_SOURCE_PAGE, -1, WHEN_PREV_PAGE, ON_PRESS },
+    { &Layout::rightButton, ACTION_SOURCE_PAGE, 1, WHEN_NEXT_PAGE, ON_PRESS },
+    { &Layout::centerButton, ACTION_SHOW_SETTINGS, 0, WHEN_ALWAYS, ON_PRESS }
+};
+
+const TouchTarget settingTargets[] = {
+    { &Layout::zone1Down, ACTION_ZONE1_STEP, -1, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::zone1Up, ACTION_ZONE1_STEP, 1, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::zone2Down, ACTION_ZONE2_STEP, -1, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::zone2Up, ACTION_ZONE2_STEP, 1, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::sourceDown, ACTION_SOURCE_STEP, -1, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::sourceUp, ACTION_SOURCE_STEP, 1, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::rebootButton, ACTION_REBOOT, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::recalibrateButton, ACTION_RECALIBRATE, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::rotateButton, ACTION_ROTATE, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::leftButton, ACTION_SAVE_SETTINGS, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::centerButton, ACTION_SHOW_ABOUT, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::rightButton, ACTION_CLOSE, 0, WHEN_ALWAYS, ON_PRESS }
+};
+
+const TouchTarget aboutTargets[] = {
+    { &Layout::leftButton, ACTION_CLOSE, 0, WHEN_ALWAYS, ON_PRESS },
+    { &Layout::rightButton, ACTION_UPDATE, 0, WHEN_UPDATE, ON_PRESS }
+};
+
+const TouchTarget zoneTargets[] = {
+    { &Layout::screen, ACTION_SHOW_SELECT, 0, WHEN_ALWAYS, ON_TAP }
+};
+
+const TouchTarget offTargets[] = {
+    { &Layout::screen, ACTION_WAKE, 0, WHEN_ALWAYS, ON_PRESS }
+};
+
+struct ScreenTargets {
+    const TouchTarget *targets;
+    uint8_t count;
+};
+
+#define TARGETS(list) { list, (sizeof(list) / sizeof(list[0])) }
+
+// Indexed by Screen
+const ScreenTargets screenTargets[SCREEN_COUNT] = {
+    TARGETS(selectTargets),
+    TARGETS(metadataTargets),
+    TARGETS(sourceTargets),
+    TARGETS(settingTargets),
+    TARGETS(aboutTargets),
+    TARGETS(zoneTargets),
+    TARGETS(offTargets)
+};
+
+bool targetActive(const TouchTarget &target)
+{
+    switch (target.when) {
+        case WHEN_PANDORA: return currentStreamType == "pandora";
+        case WHEN_ZONE2: return amplipiZone2Enabled;
+        case WHEN_PREV_PAGE: return showPrevButton;
+        case WHEN_NEXT_PAGE: return showNextButton;
+        case WHEN_UPDATE: return updateAvailable;
+        default: return true;
+    }
+}
 
-        // Turn screen back on if off
-        if (activeScreen == "off")
+// Find the touch target under x, y on the active screen
+const TouchTarget *findTarget(uint16_t x, uint16_t y, TouchTrigger trigger)
+{
+    const ScreenTargets &screen = screenTargets[activeScreen];
+    for (uint8_t i = 0; i < screen.count; i++)
+    {
+        const TouchTarget &target = screen.targets[i];
+        if (target.trigger == trigger && (layout.*target.area).contains(x, y) && targetActive(target))
         {
-            Serial.println("Turning screen back on");
+            return &target;
+        }
+    }
+    return NULL;
+}
 
-            // Reload main selection screen
-            activeScreen = "select";
-            metadata_refresh = true;
-            updateSource = true;
-            updateMute1 = true;
-            updateMute2 = true;
-            updateAlbumart = true;
-            updateVol1 = true;
-            updateVol2 = true;
-            currentSourceOffset = 0;
-
-            drawSource();
-            if (amplipiZone2Enabled) {
-                drawMuteBtn(1);
-                drawMuteBtn(2);
-            }
-            else {
-                drawMuteBtn(1);
+// Zone shown on a volume bar. In one zone mode only the lower bar is used.
+int barZone(int bar)
+{
+    if (amplipiZone2Enabled && bar == 2) { return 2; }
+    return 1;
+}
+
+// Go back to one of the main screens and redraw it
+void showMainScreen(Screen screen)
+{
+    activeScreen = screen;
+    metadata_refresh = true;
+    updateMute1 = true;
+    updateMute2 = true;
+    updateAlbumart = true;
+    updateVol1 = true;
+    updateVol2 = true;
+    sourceScrollY = 0;
+    closeSourceSelection();
+
+    if (screen == SCREEN_SELECT) {
+        updateSource = true;
+        drawSource();
+    }
+    else {
+        clearMainArea();
+    }
+
+    drawMuteBtn(1);
+    if (amplipiZone2Enabled) {
+        drawMuteBtn(2);
+    }
+    drawMetadata();
+    drawAlbumart();
+}
+
+// Put the main screen back the way it was when it turned off, from the frame cache, and refresh straight
+// after. Only what changed while the screen was off is drawn again. Returns false if no frame was kept.
+bool wakeFromFrame()
+{
+    uint32_t start = millis();
+    if (!frameCacheDraw(&tft)) {
+        return false;
+    }
+    benchPixels(layout.screen.w * layout.screen.h);
+    activeScreen = frameScreen;
+
+    int aaX, aaY, aaW;
+    albumartBox(&aaX, &aaY, &aaW);
+    bool artShown = !frameArtLeftOut || drawAlbumartFile(aaX, aaY, aaW);
+    powerOnScreen();
+    Serial.printf("Screen back from the frame cache in %lu ms\n", (unsigned long)(millis() - start));
+    frameCacheClear();
+
+    metadata_refresh = true;
+    refreshNow = true;
+    drawMetadata(); // Starts the marquee again
+    if (!artShown) {
+        updateAlbumart = true;
+        drawAlbumart();
+    }
+    return true;
+}
+
+void toggleMute(int zone)
+{
+    if (zone == 1) {
+        muteZone1 = !muteZone1;
+        updateMute1 = true;
+        updateVol1 = true;
+    }
+    else {
+        muteZone2 = !muteZone2;
+        updateMute2 = true;
+        updateVol2 = true;
+    }
+    drawMuteBtn(zone);
+    sendMuteUpdate(zone);
+    Serial.print("Mute button hit.");
+}
+
+void runTouchAction(const TouchTarget &target, uint16_t x, uint16_t y)
+{
+    switch (target.action) {
+        case ACTION_WAKE:
+            Serial.println("Turning screen back on");
+            gestureCancel(); // The rest of this touch only wakes the screen
+            if (!wakeFromFrame()) {
+                showMainScreen(SCREEN_SELECT);
+                powerOnScreen();
             }
-            //drawSource();
+            break;
+
+        case ACTION_POWER_OFF:
+            powerOffScreen();
+            Serial.print("Power off screen button hit.");
+            break;
+
+        case ACTION_SHOW_SELECT:
+            showMainScreen(SCREEN_SELECT);
+            break;
+
+        case ACTION_SHOW_METADATA:
+            activeScreen = SCREEN_METADATA;
+            Serial.print("Switching to full screen metadata mode");
+
+            clearMainArea();
             drawMetadata();
             drawAlbumart();
+            break;
 
-            powerOnScreen();
+        case ACTION_SHOW_SOURCES:
+            activeScreen = SCREEN_SOURCE;
+            sourceScrollY = 0;
+            loadStreamList();
+            drawSourceSelection();
+            Serial.print("Source select button hit.");
+            break;
 
-            delay(200); // debounce
-        }
-        else if (activeScreen == "select")
-        {
-            // Main Selection screen
-            Serial.println("Current screen: select");
+        case ACTION_CLOSE:
+            showMainScreen(SCREEN_METADATA);
+            break;
 
-            // Source Select (location: top right)
-            if ((x >= SRCBUTTON_X) && (x <= (SRCBUTTON_X + SRCBUTTON_W)) && (y >= SRCBUTTON_Y) && (y <= (SRCBUTTON_Y + SRCBUTTON_H)))
-            {
-                activeScreen = "source";
-                drawSourceSelection();
-                Serial.print("Source select button hit.");
-                delay(200); // Debounce
-            }
-            
-            // Power screen off (location: top left)
-            if ((x >= SRCBAR_X) && (x <= (SRCBAR_X + 40)) && (y >= SRCBAR_Y) && (y <= (SRCBAR_Y + 40)))
-            {
-                activeScreen = "off";
-                powerOffScreen();
-                Serial.print("Power off screen button hit.");
-                delay(200); // Debounce
-            }
+        case ACTION_STREAM_COMMAND:
+            sendCommand(streamCommands[target.arg]);
+            break;
 
-            if ((x >= ALBUMART_X) && (x <= (ALBUMART_X + ALBUMART_W)) && (y >= ALBUMART_Y) && (y <= (ALBUMART_Y + ALBUMART_H)))
-            {
-                activeScreen = "metadata";
-                Serial.print("Switching to full screen metadata mode");
+        case ACTION_MUTE:
+            toggleMute(barZone(target.arg));
+            break;
 
-                clearMainArea();
-                drawMetadata();
-                drawAlbumart();
-                delay(200); // Debounce
-            }
+        case ACTION_VOLUME:
+            setVolumeFromTouch(x, barZone(target.arg));
+            Serial.print("Volume control hit.");
+            break;
 
-            // Control buttons for supported streams
-            // Currently, only Pandora streams support these buttons
-            if (currentStreamType == "pandora")
-            {
-                // Play/pause
-                if ((x >= PLAYPAUSEBUTTON_X) && (x <= (PLAYPAUSEBUTTON_X + PLAYPAUSEBUTTON_W)) && (y >= PLAYPAUSEBUTTON_Y) && (y <= (PLAYPAUSEBUTTON_Y + PLAYPAUSEBUTTON_H))) {
-                    sendCommand("playpause");
-                }
+        case ACTION_SELECT_SOURCE:
+            selectSource((y - layout.sourceList.y + sourceScrollY) / SOURCEITEM_H);
+            showMainScreen(SCREEN_METADATA);
+            break;
 
-                // Skip
-                if ((x >= SKIPBUTTON_X) && (x <= (SKIPBUTTON_X + SKIPBUTTON_W)) && (y >= SKIPBUTTON_Y) && (y <= (SKIPBUTTON_Y + SKIPBUTTON_H))) {
-                    sendCommand("next");
-                }
+        case ACTION_SOURCE_PAGE:
+            // Show the previous or next set of streams
+            pageSourceList(target.arg);
+            break;
 
-                // Like
-                if ((x >= LIKEBUTTON_X) && (x <= (LIKEBUTTON_X + LIKEBUTTON_W)) && (y >= LIKEBUTTON_Y) && (y <= (LIKEBUTTON_Y + LIKEBUTTON_H))) {
-                    sendCommand("love");
-                }
+        case ACTION_SHOW_SETTINGS:
+            closeSourceSelection();
+            activeScreen = SCREEN_SETTING;
+            drawSettings();
+            break;
 
-                // Disike
-                if ((x >= DISLIKEBUTTON_X) && (x <= (DISLIKEBUTTON_X + DISLIKEBUTTON_W)) && (y >= DISLIKEBUTTON_Y) && (y <= (DISLIKEBUTTON_Y + DISLIKEBUTTON_H))) {
-                    sendCommand("ban");
-                }
-                delay(200); // Debounce
-            }
+        case ACTION_ZONE1_STEP:
+            newAmplipiZone1 += target.arg;
+            if (newAmplipiZone1 < 0) { newAmplipiZone1 = 0; }
+            else if (newAmplipiZone1 > 5) { newAmplipiZone1 = 5; }
 
-            // Mute button
-            if ((x > MUTE_X) && (x < (MUTE_X + MUTE_W)))
-            {
-                if (amplipiZone2Enabled && (y > MUTE1_Y) && (y <= (MUTE1_Y + MUTE_H)))
-                {
-                    // Two Zone Mode, upper section
-                    if (muteZone1) { muteZone1 = false; }
-                    else { muteZone1 = true; }
-                    updateMute1 = true;
-                    updateVol1 = true;
-                    drawMuteBtn(1);
-                    sendMuteUpdate(1);
-                    Serial.print("Mute button hit.");
-                }
-                else if ((y > MUTE2_Y) && (y <= (MUTE2_Y + MUTE_H)))
-                {
-                    if (amplipiZone2Enabled) {
-                        // Two Zone Mode, lower section
-                        if (muteZone2) { muteZone2 = false; }
-                        else { muteZone2 = true; }
-                        updateMute2 = true;
-                        updateVol2 = true;
-                        drawMuteBtn(2);
-                        sendMuteUpdate(2);
-                    }
-                    else {
-                        // One Zone Mode
-                        if (muteZone1) { muteZone1 = false; }
-                        else { muteZone1 = true; }
-                        updateMute1 = true;
-                        updateVol1 = true;
-                        drawMuteBtn(1);
-                        sendMuteUpdate(1);
-                    }
-                    Serial.print("Mute button hit.");
-                }
-                delay(200); // Debounce
-            }
+            drawSettingValue(layout.zone1Row, "Zone 1: " + String(newAmplipiZone1));
+            break;
 
-            // Volume control
-            if ((x > VOLBARZONE_X) && (x < (VOLBARZONE_X + VOLBARZONE_W)))
-            {
-                // Multiply the new volume percent by the screen width minus 80 and add 45 pixels (offset for the mute button) to get the x coord
-                float volBarWidth = (TFT_WIDTH - 80) / 100; // 1.6 for 240px screen, 2.4 for 320px screen.
-                if (amplipiZone2Enabled && (y > VOLBARZONE1_Y) && (y <= (VOLBARZONE1_Y + VOLBARZONE_H)))
-                {
-                    // Two Zone Mode, upper section
-                    updateVol1 = true;
-                    volPercent1 = (x - 40) / volBarWidth;
-                    drawVolume(x, 1);
-                    sendVolUpdate(1);
-                    Serial.print("Volume control hit.");
-                }
-                else if ((y > VOLBARZONE2_Y) && (y <= (VOLBARZONE2_Y + VOLBARZONE_H)))
-                {
-                    if (amplipiZone2Enabled) {
-                        // Two Zone Mode, lower section
-                        updateVol2 = true;
-                        volPercent2 = (x - 40) / volBarWidth;
-                        drawVolume(x, 2);
-                        sendVolUpdate(2);
-                    }
-                    else {
-                        // One Zone Mode
-                        updateVol1 = true;
-                        volPercent1 = (x - 40) / volBarWidth;
-                        drawVolume(x, 1);
-                        sendVolUpdate(1);
-                    }
-                    Serial.print("Volume control hit.");
-                }
-                delay(100); // Debounce
-            }
-        }
-        else if (activeScreen == "metadata")
+        case ACTION_ZONE2_STEP:
         {
-            // Main Selection screen
-            Serial.println("Current screen: metadata");
-
-            // Reload main selection screen
-            activeScreen = "select";
-            metadata_refresh = true;
-            updateSource = true;
-            updateMute1 = true;
-            updateMute2 = true;
-            updateAlbumart = true;
-            updateVol1 = true;
-            updateVol2 = true;
-            currentSourceOffset = 0;
-
-            drawSource();
-            if (amplipiZone2Enabled) {
-                drawMuteBtn(1);
-                drawMuteBtn(2);
-            }
-            else {
-                drawMuteBtn(1);
-            }
-            //drawSource();
-            drawMetadata();
-            drawAlbumart();
+            newAmplipiZone2 += target.arg;
+            if (newAmplipiZone2 < -1) { newAmplipiZone2 = -1; }
+            else if (newAmplipiZone2 > 5) { newAmplipiZone2 = 5; }
 
+            String thisZone;
+            if (newAmplipiZone2 < 0) { thisZone = "None"; }
+            else { thisZone = String(newAmplipiZone2); }
+
+            drawSettingValue(layout.zone2Row, "Zone 2: " + thisZone);
+            break;
         }
-        else if (activeScreen == "source")
-        {
-            // Source Selection screen
-            Serial.println("Current screen: source");
 
-            // Power screen off (location: top left)
-            if ((x >= SRCBAR_X) && (x <= (SRCBAR_X + 36)) && (y >= SRCBAR_Y) && (y <= (SRCBAR_Y + 36)))
-            {
-                activeScreen = "off";
-                powerOffScreen();
-                Serial.print("Power off screen button hit.");
-            }
-            // Source Select button (cancel source select)
-            else if ((x > SRCBUTTON_X) && (x < (SRCBUTTON_X + SRCBUTTON_W)))
-            {
-                if ((y > SRCBUTTON_Y) && (y <= (SRCBUTTON_Y + SRCBUTTON_H)))
-                {
-                    // Reload main metadata screen
-                    activeScreen = "metadata";
-                    metadata_refresh = true;
-                    updateMute1 = true;
-                    updateMute2 = true;
-                    updateAlbumart = true;
-                    updateVol1 = true;
-                    updateVol2 = true;
-                    currentSourceOffset = 0;
-
-                    clearMainArea();
-                    if (amplipiZone2Enabled) {
-                        drawMuteBtn(1);
-                        drawMuteBtn(2);
-                    }
-                    else {
-                        drawMuteBtn(1);
-                    }
-                    drawMetadata();
-                    drawAlbumart();
-                }
-            }
-            // Select source (anything between source bar and Prev/Next buttons)
-            else if ((y > 36) && (y <= RIGHTBUTTON_Y))
-            {
-                selectSource(y);
-
-                // Reload main metadata screen
-                activeScreen = "metadata";
-                metadata_refresh = true;
-                updateMute1 = true;
-                updateMute2 = true;
-                updateAlbumart = true;
-                updateVol1 = true;
-                updateVol2 = true;
-                currentSourceOffset = 0;
-
-                clearMainArea();
-                if (amplipiZone2Enabled) {
-                    drawMuteBtn(1);
-                    drawMuteBtn(2);
-                }
-                else {
-                    drawMuteBtn(1);
-                }
-                drawMetadata();
-                drawAlbumart();
-            }
-            // Previous list of sources
-            else if ((x > LEFTBUTTON_X) && (x < (LEFTBUTTON_X + LEFTBUTTON_W)))
-            {
-                if ((y > LEFTBUTTON_Y) && (y <= (LEFTBUTTON_Y + LEFTBUTTON_H)))
-                {
-                    // Show previous set of streams
-                    currentSourceOffset = currentSourceOffset - MAX_STREAMS;
-                    if (currentSourceOffset < 0) { currentSourceOffset = 0; }
-                    drawSourceSelection();
-                }
-            }
-            // Next list of sources
-            else if ((x > RIGHTBUTTON_X) && (x < (RIGHTBUTTON_X + RIGHTBUTTON_W)))
-            {
-                if ((y > RIGHTBUTTON_Y) && (y <= (RIGHTBUTTON_Y + RIGHTBUTTON_H)))
-                {
-                    // Show next set of streams
-                    currentSourceOffset = currentSourceOffset + MAX_STREAMS;
-                    drawSourceSelection();
-                }
-            }
-            // Settings screen
-            else if ((x > CENTERBUTTON_X) && (x < (CENTERBUTTON_X + CENTERBUTTON_W)))
-            {
-                if ((y > CENTERBUTTON_Y) && (y <= (CENTERBUTTON_Y + CENTERBUTTON_H)))
-                {
-                    // Show settings screen
-                    activeScreen = "setting";
-                    drawSettings();
-                }
-            }
+        case ACTION_SOURCE_STEP:
+            newAmplipiSource += target.arg;
+            if (newAmplipiSource < 0) { newAmplipiSource = 0; }
+            else if (newAmplipiSource > 3) { newAmplipiSource = 3; }
 
-            delay(200); // Debounce
-        }
-        else if (activeScreen == "about")
-        {
-            // Close button
-            if ((x > LEFTBUTTON_X) && (x < (LEFTBUTTON_X + LEFTBUTTON_W)) && (y > LEFTBUTTON_Y) && (y <= (LEFTBUTTON_Y + LEFTBUTTON_H)))
-            {
-                // Reload main metadata screen
-                activeScreen = "metadata";
-                metadata_refresh = true;
-                updateMute1 = true;
-                updateMute2 = true;
-                updateAlbumart = true;
-                updateVol1 = true;
-                updateVol2 = true;
-                currentSourceOffset = 0;
-
-                clearMainArea();
-                if (amplipiZone2Enabled) {
-                    drawMuteBtn(1);
-                    drawMuteBtn(2);
-                }
-                else {
-                    drawMuteBtn(1);
-                }
-                drawMetadata();
-                drawAlbumart();
-            }
-            
-            // Update Controller button
-            if ((x > RIGHTBUTTON_X) && (x < (RIGHTBUTTON_X + RIGHTBUTTON_W)) && (y > RIGHTBUTTON_Y) && (y <= (RIGHTBUTTON_Y + RIGHTBUTTON_H)))
-            {
-                updateController();
-            }
-            delay(200); // Debounce
-        }
-        else if (activeScreen == "setting")
-        {
-            // Zone 1 Change
-            if ((y > 50) && (y <= 90))
-            {
-                if ((x > (TFT_WIDTH - 80)) && (x < (TFT_WIDTH - 40))) { --newAmplipiZone1; } // Decrement zone number
-                else if ((x > (TFT_WIDTH - 40)) && (x < TFT_WIDTH)) { ++newAmplipiZone1; } // Increment zone number
+            drawSettingValue(layout.sourceRow, "Source: " + String(newAmplipiSource));
+            break;
 
-                if (newAmplipiZone1 < 0) { newAmplipiZone1 = 0; }
-                else if (newAmplipiZone1 > 5) { newAmplipiZone1 = 5; }
+        case ACTION_REBOOT:
+            ESP.restart();
+            break;
 
-                tft.fillRect(0, 41, 160, 38, TFT_BLACK);
-                tft.drawString("Zone 1: " + String(newAmplipiZone1), 5, 55);
-            }
-            // Zone 2 Change
-            else if ((y > 90) && (y <= 130))
-            {
-                if ((x > (TFT_WIDTH - 80)) && (x < (TFT_WIDTH - 40))) { --newAmplipiZone2; } // Decrement zone number
-                else if ((x > (TFT_WIDTH - 40)) && (x < TFT_WIDTH)) { ++newAmplipiZone2; } // Increment zone number
-
-                if (newAmplipiZone2 < -1) { newAmplipiZone2 = -1; }
-                else if (newAmplipiZone2 > 5) { newAmplipiZone2 = 5; }
-                
-                String thisZone;
-                if (newAmplipiZone2 < 0) { thisZone = "None"; }
-                else { thisZone = String(newAmplipiZone2); }
-
-                tft.fillRect(0, 81, 160, 38, TFT_BLACK);
-                tft.drawString("Zone 2: " + thisZone, 5, 95);
-            }
-            // Source Change
-            else if ((y > 130) && (y <= 170))
-            {
-                if ((x > (TFT_WIDTH - 80)) && (x < (TFT_WIDTH - 40))) { --newAmplipiSource; } // Decrement source number
-                else if ((x > (TFT_WIDTH - 40)) && (x < TFT_WIDTH)) { ++newAmplipiSource; } // Increment source number
+        case ACTION_RECALIBRATE:
+            // Clear the touch calibration and reboot
+            clearTouchCalibration();
+            ESP.restart();
+            break;
 
-                if (newAmplipiSource < 0) { newAmplipiSource = 0; }
-                else if (newAmplipiSource > 3) { newAmplipiSource = 3; }
+        case ACTION_ROTATE:
+            rotateScreen((screenRotation + 1) & 3);
+            saveConfig();
+            break;
 
-                tft.fillRect(0, 121, 160, 38, TFT_BLACK);
-                tft.drawString("Source: " + String(newAmplipiSource), 5, 135);
-            }
+        case ACTION_SAVE_SETTINGS:
+            // Save Settings
+            sprintf(amplipiZone1, "%d", newAmplipiZone1);
+            sprintf(amplipiZone2, "%d", newAmplipiZone2);
+            sprintf(amplipiSource, "%d", newAmplipiSource);
+            saveConfig();
 
-            // Restart
-            if ((y >= 180) && (y < 220))
-            {
-                ESP.restart();
-            }
+            // A 404 may have come from the AmpliPi restarting, give the controller routes another try
+            controllerRouteAvailable = true;
+            changesBegin();
 
-            // Re-calibrate Touchscreen
-            if ((y >= 220) && (y < 260))
-            {
-                // Delete TouchCalData file and reboot
-                if (SPIFFS.exists(CALIBRATION_FILE))
-                {
-                    // Delete if we want to re-calibrate
-                    SPIFFS.remove(CALIBRATION_FILE);
-                }
-                ESP.restart();
-            }
+            // If the new amplipiZone2 setting is 0 or great, Zone 2 should be enabled
+            if (newAmplipiZone2 >= 0) { amplipiZone2Enabled = true; }
+            else { amplipiZone2Enabled = false; }
 
-            // Rotate Touchscreen
-            if ((y >= 260) && (y < 292))
-            {
-                uint8_t currentRotation = tft.getRotation();
-                Serial.print("Current rotation: ");
-                Serial.println(currentRotation);
-                if (currentRotation == 0)
-                {
-                    tft.setRotation(2);
+            showMainScreen(SCREEN_METADATA);
+            break;
 
-                }
-                else {
-                    tft.setRotation(0);
-                }
+        case ACTION_SHOW_ABOUT:
+            drawAbout();
+            break;
 
-                saveFileFSConfigFile();
+        case ACTION_UPDATE:
+            updateController();
+            break;
 
-                // Delete TouchCalData file and reboot
-                if (SPIFFS.exists(CALIBRATION_FILE))
-                {
-                    // Delete if we want to re-calibrate
-                    SPIFFS.remove(CALIBRATION_FILE);
-                }
-                ESP.restart();
+        case ACTION_SHOW_ZONE:
+            drawZoneDetails(barZone(target.arg));
+            break;
+    }
+}
+
+// Handle a touch on the screen by looking it up in the active screen's touch targets
+void handleTouch(uint16_t x, uint16_t y, TouchTrigger trigger)
+{
+    const TouchTarget *target = findTarget(x, y, trigger);
+    if (target != NULL)
+    {
+        runTouchAction(*target, x, y);
+    }
+}
+
+// Swipes and drags only do something on the source selection screen, where they page and scroll the list
+void handleGesture(const Gesture &gesture)
+{
+    switch (gesture.type) {
+        case GESTURE_TAP:
+            if (!tapStopsScroll) {
+                handleTouch(gesture.x, gesture.y, ON_TAP);
             }
+            break;
 
-            // Save Changes
-            if ((x > LEFTBUTTON_X) && (x < (LEFTBUTTON_X + LEFTBUTTON_W)))
-            {
-                if ((y > LEFTBUTTON_Y) && (y <= (LEFTBUTTON_Y + LEFTBUTTON_H)))
-                {
-                    // Save Settings
-                    sprintf(amplipiZone1, "%d", newAmplipiZone1);
-                    sprintf(amplipiZone2, "%d", newAmplipiZone2);
-                    sprintf(amplipiSource, "%d", newAmplipiSource);
-                    saveFileFSConfigFile();
-                    
-                    // If the new amplipiZone2 setting is 0 or great, Zone 2 should be enabled
-                    if (newAmplipiZone2 >= 0) { amplipiZone2Enabled = true; }
-                    else { amplipiZone2Enabled = false; }
-
-                    // Reload main metadata screen
-                    activeScreen = "metadata";
-                    metadata_refresh = true;
-                    updateMute1 = true;
-                    updateMute2 = true;
-                    updateAlbumart = true;
-                    updateVol1 = true;
-                    updateVol2 = true;
-                    currentSourceOffset = 0;
-
-                    clearMainArea();
-                    if (amplipiZone2Enabled) {
-                        drawMuteBtn(1);
-                        drawMuteBtn(2);
-                    }
-                    else {
-                        drawMuteBtn(1);
-                    }
-                    drawMetadata();
-                    drawAlbumart();
-                }
+        case GESTURE_LONG_PRESS:
+            handleTouch(gesture.x, gesture.y, ON_LONG_PRESS);
+            break;
+
+        case GESTURE_SWIPE_LEFT:
+        case GESTURE_SWIPE_RIGHT:
+            if (activeScreen == SCREEN_SOURCE) {
+                pageSourceList((gesture.type == GESTURE_SWIPE_LEFT) ? 1 : -1);
             }
+            break;
 
-            // About Screen
-            if ((x > CENTERBUTTON_X) && (x < (CENTERBUTTON_X + CENTERBUTTON_W)) && (y > RIGHTBUTTON_Y) && (y <= (RIGHTBUTTON_Y + RIGHTBUTTON_H)))
-            {
-                drawAbout();
+        case GESTURE_DRAG:
+            if (activeScreen == SCREEN_SOURCE && listSpriteReady && gesture.y >= layout.sourceList.y && gesture.y < (layout.sourceList.y + layout.sourceList.h)) {
+                sourceScrollDrag -= gesture.dy;
             }
-            
-            // Cancel Changes
-            if ((x > RIGHTBUTTON_X) && (x < (RIGHTBUTTON_X + RIGHTBUTTON_W)))
-            {
-                if ((y > RIGHTBUTTON_Y) && (y <= (RIGHTBUTTON_Y + RIGHTBUTTON_H)))
-                {
-                    // Reload main metadata screen
-                    activeScreen = "metadata";
-                    metadata_refresh = true;
-                    updateMute1 = true;
-                    updateMute2 = true;
-                    updateAlbumart = true;
-                    updateVol1 = true;
-                    updateVol2 = true;
-                    currentSourceOffset = 0;
-
-                    clearMainArea();
-                    if (amplipiZone2Enabled) {
-                        drawMuteBtn(1);
-                        drawMuteBtn(2);
-                    }
-                    else {
-                        drawMuteBtn(1);
-                    }
-                    drawMetadata();
-                    drawAlbumart();
-                }
+            break;
+
+        case GESTURE_DRAG_END:
+            if (activeScreen == SCREEN_SOURCE && listSpriteReady) {
+                sourceScrollVelocity = gesture.velocity;
+                lastScrollFrame = millis();
             }
-            delay(200); // Debounce
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * This is where the touch events and automatic metadata refresh happen.
+ * Touches are sampled by the touch task (see touchinput.cpp) and arrive here as press, move and release events.
+ */
+void loop() {
+    acquireDisplay();
+    uint32_t frameStart = micros();
+
+    // Nothing allocated from the refresh arena outlives a pass of loop()
+    arenaReset(refreshArena);
+
+    // Touches sent by tools/trace_replay.py
+    traceReadSerial();
+
+    TouchEvent event;
+    Gesture gesture;
+    static bool wakeTouch = false; // Touch that brought the dimmed screen back, it does nothing else
+    while (touchGetEvent(&event))
+    {
+        traceTouch(event);
+        artActivity();
+        idleTouch();
+        if (event.type == TOUCH_PRESS && idleState() == IDLE_DIMMED)
+        {
+            Serial.println("Waking dimmed screen");
+            idleSetState(IDLE_ACTIVE);
+            wakeTouch = true;
+        }
+        if (wakeTouch)
+        {
+            wakeTouch = (event.type != TOUCH_RELEASE);
+            continue;
+        }
+
+        if (gestureFeed(event, &gesture))
+        {
+            handleGesture(gesture);
+        }
+
+        if (event.type == TOUCH_PRESS)
+        {
+            Serial.print("X: ");
+            Serial.print(event.x);
+            Serial.print(" - Y: ");
+            Serial.println(event.y);
+
+            tapStopsScroll = (sourceScrollVelocity != 0);
+            sourceScrollVelocity = 0;
+            handleTouch(event.x, event.y, ON_PRESS);
+        }
+        else if (event.type == TOUCH_MOVE && volDragZone != 0)
+        {
+            // Volume bar follows the finger
+            setVolumeFromTouch(event.x, volDragZone);
+        }
+        else if (event.type == TOUCH_RELEASE)
+        {
+            // Always send where the drag ended
+            sendPendingVolume(true);
+            volDragZone = 0;
+        }
+    }
+    if (gesturePoll(millis(), &gesture))
+    {
+        handleGesture(gesture);
+    }
+    sendPendingVolume(false);
+    applyCommandResults();
+
+    // Drag moves are added up and the list is scrolled once per pass
+    if (sourceScrollDrag != 0)
+    {
+        scrollSourceList(sourceScrollY + sourceScrollDrag);
+        sourceScrollDrag = 0;
+    }
+    animateSourceList();
+
+    // First boot: swap the welcome screen for the main screen once we're connected
+    if (networkScreenShown && eth_connected) {
+        Serial.print("Connected to network. Local IP: ");
+        Serial.println(ETH.localIP());
+        networkScreenShown = false;
+        tft.fillScreen(TFT_BLACK);
+        benchPixels(layout.screen.w * layout.screen.h);
+        forgetVolumeBars();
+        tft.setTextDatum(TL_DATUM);
+        tft.setFreeFont(FSS12);
+    }
+
+    // Remember a newly resolved AmpliPi address for the next boot
+    if (hostIPChanged) {
+        hostIPChanged = false;
+        strncpy(lastHostIP, getAmpliPiHostIP().c_str(), sizeof(lastHostIP));
+        saveHostIP();
+    }
+
+    // Changes the AmpliPi sent through the long poll
+    if (metadata_refresh) {
+        applyChanges();
+    }
+
+    // Dim, then turn the screen off, when nobody has touched it for a while
+    IdleState idleDueState = idleDue(millis());
+    if (idleDueState != idleState())
+    {
+        if (idleDueState == IDLE_DIMMED) {
+            idleSetState(IDLE_DIMMED);
+        }
+        else if (activeScreen != SCREEN_OFF) {
+            Serial.println("Turning screen off after idle timeout");
+            powerOffScreen();
         }
     }
 
-    // Metadata refresh loop
+    // Metadata refresh loop. While dimmed it keeps going slower, so the screen is current when touched.
     static unsigned long lastRefreshTime = 0;
-    if (millis() - lastRefreshTime >= REFRESH_INTERVAL)
+    unsigned long refreshInterval = changesActive ? CHANGES_REFRESH_INTERVAL : REFRESH_INTERVAL;
+    if (idleState() == IDLE_DIMMED && refreshInterval < IDLE_REFRESH_INTERVAL) {
+        refreshInterval = IDLE_REFRESH_INTERVAL;
+    }
+    if (refreshNow || millis() - lastRefreshTime >= refreshInterval)
     {
-        if (metadata_refresh) {
+        refreshNow = false;
+        if (!eth_connected) {
+            if (!networkScreenShown) { drawWarning("Connecting to network"); }
+        }
+        else if (metadata_refresh && !hostIPKnown()) {
+            drawWarning("Looking for AmpliPi at: " + String(amplipiHost));
+        }
+        else if (metadata_refresh) {
             Serial.println("Refreshing metadata");
-            getZone();
-            getSource(String(amplipiSource));
+            if (!controllerRouteAvailable || !getControllerState()) {
+                getZone();
+                getSource(String(amplipiSource));
+            }
+
+            // Stream logos are prefetched when the stream list loads, so load it once at startup too
+            static bool streamsLoaded = false;
+            if (!streamsLoaded) {
+                loadStreamList();
+                streamsLoaded = true;
+            }
         }
-        lastRefreshTime += REFRESH_INTERVAL;
+        lastRefreshTime = millis();
     }
+
+    // Keep the boot snapshot current, but don't wear the flash on every change
+    static unsigned long lastSnapshotTime = 0;
+    if (snapshotDirty && millis() - lastSnapshotTime >= SNAPSHOT_INTERVAL)
+    {
+        saveStateSnapshot();
+        lastSnapshotTime = millis();
+    }
+
+    benchFrame(micros() - frameStart);
+    benchReport(millis());
+    releaseDisplay();
 }
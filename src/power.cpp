@@ -0,0 +1,70 @@
+#include <power.h>
+
+static IdleState currentState = IDLE_ACTIVE;
+static volatile uint32_t lastTouch = 0;
+
+static void backlightWrite(uint8_t level)
+{
+#if defined(TFT_BACKLIGHT_ON) && (TFT_BACKLIGHT_ON == LOW)
+    level = BACKLIGHT_FULL - level;
+#endif
+    ledcWrite(BACKLIGHT_CHANNEL, level);
+}
+
+void powerBegin()
+{
+    ledcSetup(BACKLIGHT_CHANNEL, BACKLIGHT_PWM_FREQ, BACKLIGHT_PWM_BITS);
+    ledcAttachPin(TFT_BL, BACKLIGHT_CHANNEL);
+    backlightWrite(BACKLIGHT_FULL);
+    lastTouch = millis();
+}
+
+void idleSetState(IdleState state)
+{
+    if (state == currentState)
+    {
+        return;
+    }
+    Serial.printf("Idle state %d -> %d\n", currentState, state);
+
+    switch (state)
+    {
+        case IDLE_ACTIVE:
+            // Speed up before drawing the screen again
+            setCpuFrequencyMhz(CPU_FREQ_ACTIVE);
+            backlightWrite(BACKLIGHT_FULL);
+            lastTouch = millis();
+            break;
+
+        case IDLE_DIMMED:
+            backlightWrite(BACKLIGHT_DIM);
+            setCpuFrequencyMhz(CPU_FREQ_IDLE);
+            break;
+
+        case IDLE_OFF:
+            backlightWrite(0);
+            setCpuFrequencyMhz(CPU_FREQ_IDLE);
+            break;
+    }
+    currentState = state;
+}
+
+IdleState idleState()
+{
+    return currentState;
+}
+
+void idleTouch()
+{
+    lastTouch = millis();
+}
+
+IdleState idleDue(uint32_t now)
+{
+    uint32_t idle = now - lastTouch;
+    IdleState due = IDLE_ACTIVE;
+    if (idle >= IDLE_OFF_TIMEOUT) { due = IDLE_OFF; }
+    else if (idle >= IDLE_DIM_TIMEOUT) { due = IDLE_DIMMED; }
+
+    return (due > currentState) ? due : currentState;
+}
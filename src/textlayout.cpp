@@ -0,0 +1,305 @@
+#include <textlayout.h>
+#include <esp_timer.h>
+#include <trace.h>
+
+struct FontAdvances {
+    const GFXfont *font;
+    uint8_t advance[95]; // Printable ASCII, ' ' to '~'
+};
+
+static FontAdvances fontCache[TEXT_FONT_CACHE];
+static uint8_t fontCacheCount = 0;
+
+static TextLine *marqueeLines[MARQUEE_LINES];
+static uint8_t marqueeLineCount = 0;
+static SemaphoreHandle_t marqueeSpiLock = NULL;
+static TaskHandle_t marqueeTask = NULL;
+
+// Glyph advances for a font, read from its glyph table the first time it's used
+static const uint8_t *advancesFor(const GFXfont *font)
+{
+    for (uint8_t i = 0; i < fontCacheCount; i++)
+    {
+        if (fontCache[i].font == font)
+        {
+            return fontCache[i].advance;
+        }
+    }
+
+    // Reuse the oldest slot once the cache is full
+    FontAdvances &entry = fontCache[fontCacheCount < TEXT_FONT_CACHE ? fontCacheCount++ : 0];
+    entry.font = font;
+    uint16_t first = pgm_read_word(&font->first);
+    uint16_t last = pgm_read_word(&font->last);
+    GFXglyph *glyphs = (GFXglyph *)(uintptr_t)pgm_read_dword(&font->glyph);
+    for (uint16_t c = ' '; c <= '~'; c++)
+    {
+        entry.advance[c - ' '] = (c >= first && c <= last) ? pgm_read_byte(&glyphs[c - first].xAdvance) : 0;
+    }
+    return entry.advance;
+}
+
+// Advance of the character starting at text[i]. Multi byte UTF-8 characters aren't in the fonts, so they
+// take no space; len is set to the bytes the character uses.
+static uint8_t charAdvance(const uint8_t *advance, const char *text, size_t i, size_t *len)
+{
+    uint8_t c = text[i];
+    *len = 1;
+    if (c < 0x80)
+    {
+        return (c >= ' ' && c <= '~') ? advance[c - ' '] : 0;
+    }
+    while ((text[i + *len] & 0xC0) == 0x80)
+    {
+        (*len)++;
+    }
+    return 0;
+}
+
+int16_t textWidth(const GFXfont *font, const char *text)
+{
+    const uint8_t *advance = advancesFor(font);
+    int16_t width = 0;
+    size_t len;
+    for (size_t i = 0; text[i] != '\0'; i += len)
+    {
+        width += charAdvance(advance, text, i, &len);
+    }
+    return width;
+}
+
+String textFit(const GFXfont *font, const String &text, int16_t maxWidth)
+{
+    if (textWidth(font, text.c_str()) <= maxWidth)
+    {
+        return text;
+    }
+
+    const uint8_t *advance = advancesFor(font);
+    int16_t room = maxWidth - textWidth(font, TEXT_ELLIPSIS);
+    int16_t width = 0;
+    size_t cut = 0;
+    size_t len;
+    const char *s = text.c_str();
+    for (size_t i = 0; s[i] != '\0'; i += len)
+    {
+        width += charAdvance(advance, s, i, &len);
+        if (width > room)
+        {
+            break;
+        }
+        cut = i + len;
+    }
+
+    // Don't leave a space before the ellipsis
+    while (cut > 0 && s[cut - 1] == ' ')
+    {
+        cut--;
+    }
+    return text.substring(0, cut) + TEXT_ELLIPSIS;
+}
+
+void textLineBegin(TextLine &line, TFT_eSPI *display, const GFXfont *font, int16_t w, int16_t h, uint16_t fg, uint16_t bg)
+{
+    line.font = font;
+    line.w = w;
+    line.h = h;
+    line.fg = fg;
+    line.bg = bg;
+    line.text = "";
+    line.shown = "";
+    line.rendered = false;
+    line.marquee = false;
+    line.scrolling = false;
+    line.visible = false;
+
+    line.sprite = new TFT_eSprite(display);
+    line.sprite->setColorDepth(1);
+    line.spriteReady = (line.sprite->createSprite(w, h) != NULL);
+}
+
+bool textLineSet(TextLine &line, const String &text)
+{
+    if (text == line.text)
+    {
+        return false;
+    }
+    line.text = text;
+    line.textW = textWidth(line.font, text.c_str());
+    line.scrolling = (line.marquee && line.spriteReady && line.textW > line.w && line.textW <= MARQUEE_MAX_W);
+    line.shown = line.scrolling ? text : textFit(line.font, text, line.w);
+    line.rendered = false;
+    return true;
+}
+
+// Render the text into a strip twice, so any window up to one text width plus the gap in is complete
+static bool renderStrip(TextLine &line)
+{
+    int16_t stripW = line.textW + MARQUEE_GAP + line.w;
+    if (line.sprite->width() != stripW)
+    {
+        line.sprite->deleteSprite();
+        if (line.sprite->createSprite(stripW, line.h) == NULL)
+        {
+            // Not enough memory for the strip, go back to a cut line
+            line.spriteReady = (line.sprite->createSprite(line.w, line.h) != NULL);
+            line.scrolling = false;
+            line.shown = textFit(line.font, line.text, line.w);
+            return false;
+        }
+    }
+    line.sprite->fillSprite(0);
+    line.sprite->setFreeFont(line.font);
+    line.sprite->setTextColor(1);
+    line.sprite->setTextDatum(TL_DATUM);
+    line.sprite->drawString(line.shown, 0, 0, GFXFF);
+    line.sprite->drawString(line.shown, line.textW + MARQUEE_GAP, 0, GFXFF);
+    line.offset = 0;
+    line.holdUntil = millis() + MARQUEE_PAUSE;
+    return true;
+}
+
+// Push the current window of a scrolling line
+static void pushWindow(TextLine &line)
+{
+    line.sprite->setBitmapColor(line.fg, line.bg);
+    line.sprite->pushSprite(line.x, line.y, line.offset, 0, line.w, line.h);
+    benchPixels(line.w * line.h);
+}
+
+void textLineDraw(TextLine &line, TFT_eSPI *display, int16_t x, int16_t y)
+{
+    if (!line.spriteReady)
+    {
+        display->fillRect(x, y, line.w, line.h, line.bg);
+        display->setFreeFont(line.font);
+        display->setTextColor(line.fg, line.bg);
+        display->setTextDatum(TC_DATUM);
+        display->drawString(line.shown, x + (line.w / 2), y, GFXFF);
+        display->setTextDatum(TL_DATUM);
+        return;
+    }
+
+    line.x = x;
+    line.y = y;
+    line.visible = true;
+
+    if (line.scrolling && (line.rendered || renderStrip(line)))
+    {
+        line.rendered = true;
+        pushWindow(line);
+        return;
+    }
+
+    if (line.sprite->width() != line.w)
+    {
+        // Was a marquee strip
+        line.sprite->deleteSprite();
+        line.spriteReady = (line.sprite->createSprite(line.w, line.h) != NULL);
+        if (!line.spriteReady)
+        {
+            textLineDraw(line, display, x, y);
+            return;
+        }
+    }
+
+    if (!line.rendered)
+    {
+        line.sprite->fillSprite(0);
+        line.sprite->setFreeFont(line.font);
+        line.sprite->setTextColor(1);
+        line.sprite->setTextDatum(TC_DATUM);
+        line.sprite->drawString(line.shown, line.w / 2, 0, GFXFF);
+        line.rendered = true;
+    }
+    line.sprite->setBitmapColor(line.fg, line.bg);
+    line.sprite->pushSprite(x, y);
+    benchPixels(line.w * line.h);
+}
+
+void textLineResize(TextLine &line, int16_t w)
+{
+    line.w = w;
+    line.text = "";
+    line.shown = "";
+    line.rendered = false;
+    line.scrolling = false;
+    line.visible = false;
+
+    line.sprite->deleteSprite();
+    line.spriteReady = (line.sprite->createSprite(w, line.h) != NULL);
+}
+
+void textLineHide(TextLine &line)
+{
+    line.visible = false;
+}
+
+void marqueeAdd(TextLine &line)
+{
+    line.marquee = true;
+    if (marqueeLineCount < MARQUEE_LINES)
+    {
+        marqueeLines[marqueeLineCount++] = &line;
+    }
+}
+
+// Move a scrolling line on by one frame. No glyphs are drawn and nothing is allocated here.
+static void marqueeTick(TextLine &line, uint32_t now)
+{
+    if (!line.visible || !line.scrolling || !line.rendered || (int32_t)(now - line.holdUntil) < 0)
+    {
+        return;
+    }
+
+    line.offset += MARQUEE_STEP;
+    if (line.offset >= line.textW + MARQUEE_GAP)
+    {
+        // The repeat is now where the text started, hold it there for a moment
+        line.offset = 0;
+        line.holdUntil = now + MARQUEE_PAUSE;
+    }
+    pushWindow(line);
+}
+
+static void marqueeTimer(void *arg)
+{
+    xTaskNotifyGive(marqueeTask);
+}
+
+static void marqueeLoop(void *parameter)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // The lock also guards the lines, loop() only changes them while it holds it. Skip the frame if it's busy.
+        if (xSemaphoreTake(marqueeSpiLock, pdMS_TO_TICKS(MARQUEE_FRAME_INTERVAL)) != pdTRUE)
+        {
+            continue;
+        }
+        uint32_t now = millis();
+        for (uint8_t i = 0; i < marqueeLineCount; i++)
+        {
+            marqueeTick(*marqueeLines[i], now);
+        }
+        xSemaphoreGive(marqueeSpiLock);
+    }
+}
+
+void marqueeBegin(SemaphoreHandle_t spiLock)
+{
+    marqueeSpiLock = spiLock;
+
+    // Same core and priority as the touch task, so it gets the display as soon as loop() lets go
+    xTaskCreatePinnedToCore(marqueeLoop, "marquee", 2048, NULL, 2, &marqueeTask, 1);
+
+    esp_timer_handle_t timer;
+    esp_timer_create_args_t args = {};
+    args.callback = marqueeTimer;
+    args.name = "marquee";
+    if (esp_timer_create(&args, &timer) == ESP_OK)
+    {
+        esp_timer_start_periodic(timer, MARQUEE_FRAME_INTERVAL * 1000);
+    }
+}
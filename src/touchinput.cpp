@@ -0,0 +1,303 @@
+#include <touchinput.h>
+
+static TFT_eSPI *touchDisplay = NULL;
+static SemaphoreHandle_t touchSpiLock = NULL;
+static QueueHandle_t touchQueue = NULL;
+
+// Gesture recognizer state for the touch in progress
+static bool gestureActive = false;
+static bool gestureDragging = false;
+static bool gestureLongPressed = false;
+static uint16_t gestureStartX = 0;
+static uint16_t gestureStartY = 0;
+static uint32_t gestureStartTime = 0;
+static uint16_t gestureLastY = 0;
+static uint32_t gestureLastTime = 0;
+static uint16_t gestureMaxDistance = 0; // Furthest the touch has been from where it started
+static float gestureVelocity = 0;
+
+// Median of a small array, sorts in place
+static uint16_t median(uint16_t *values, uint8_t count)
+{
+    for (uint8_t i = 1; i < count; i++)
+    {
+        uint16_t value = values[i];
+        int8_t j = i - 1;
+        while (j >= 0 && values[j] > value)
+        {
+            values[j + 1] = values[j];
+            --j;
+        }
+        values[j + 1] = value;
+    }
+    return values[count / 2];
+}
+
+// Take one filtered reading. Returns false if the screen isn't being touched.
+static bool readTouch(uint16_t *x, uint16_t *y)
+{
+    uint16_t xs[TOUCH_SAMPLES];
+    uint16_t ys[TOUCH_SAMPLES];
+
+    if (touchDisplay->getTouchRawZ() < TOUCH_Z_THRESHOLD)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < TOUCH_SAMPLES; i++)
+    {
+        touchDisplay->getTouchRaw(&xs[i], &ys[i]);
+    }
+
+    // Finger may have lifted while we were sampling
+    if (touchDisplay->getTouchRawZ() < TOUCH_Z_THRESHOLD)
+    {
+        return false;
+    }
+
+    *x = median(xs, TOUCH_SAMPLES);
+    *y = median(ys, TOUCH_SAMPLES);
+    touchDisplay->convertRawXY(x, y);
+
+    // Calibration can map readings near the edge off screen
+    return (*x < touchDisplay->width() && *y < touchDisplay->height());
+}
+
+static void sendEvent(TouchEventType type, uint16_t x, uint16_t y)
+{
+    TouchEvent event = { type, x, y, (uint32_t)millis() };
+
+    // Moves are only useful while they're fresh, so drop them if the UI is behind.
+    // Presses and releases wait for room so taps are never lost.
+    TickType_t wait = (type == TOUCH_MOVE) ? 0 : pdMS_TO_TICKS(100);
+    xQueueSend(touchQueue, &event, wait);
+}
+
+static void touchLoop(void *parameter)
+{
+    bool pressed = false;
+    uint8_t pressCount = 0;
+    uint8_t releaseCount = 0;
+    uint16_t lastX = 0;
+    uint16_t lastY = 0;
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;)
+    {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(TOUCH_SAMPLE_INTERVAL));
+
+        // Skip this sample if the display is busy, we'll catch the next one
+        if (xSemaphoreTake(touchSpiLock, pdMS_TO_TICKS(TOUCH_SAMPLE_INTERVAL)) != pdTRUE)
+        {
+            continue;
+        }
+        uint16_t x, y;
+        bool touched = readTouch(&x, &y);
+        xSemaphoreGive(touchSpiLock);
+
+        if (touched)
+        {
+            releaseCount = 0;
+            if (!pressed)
+            {
+                if (++pressCount >= TOUCH_PRESS_SAMPLES)
+                {
+                    pressed = true;
+                    lastX = x;
+                    lastY = y;
+                    sendEvent(TOUCH_PRESS, x, y);
+                }
+            }
+            else if (abs((int)x - (int)lastX) >= TOUCH_MOVE_THRESHOLD || abs((int)y - (int)lastY) >= TOUCH_MOVE_THRESHOLD)
+            {
+                lastX = x;
+                lastY = y;
+                sendEvent(TOUCH_MOVE, x, y);
+            }
+        }
+        else
+        {
+            pressCount = 0;
+            if (pressed && ++releaseCount >= TOUCH_RELEASE_SAMPLES)
+            {
+                pressed = false;
+                sendEvent(TOUCH_RELEASE, lastX, lastY);
+            }
+        }
+    }
+}
+
+void touchBegin(TFT_eSPI *display, SemaphoreHandle_t spiLock)
+{
+    touchDisplay = display;
+    touchSpiLock = spiLock;
+    touchQueue = xQueueCreate(32, sizeof(TouchEvent));
+
+    // Higher priority than loop() so sampling stays on schedule
+    xTaskCreatePinnedToCore(touchLoop, "touch", 2048, NULL, 2, NULL, 1);
+}
+
+bool touchGetEvent(TouchEvent *event)
+{
+    if (touchQueue == NULL)
+    {
+        return false;
+    }
+    return xQueueReceive(touchQueue, event, 0) == pdTRUE;
+}
+
+void touchFlush()
+{
+    if (touchQueue != NULL)
+    {
+        xQueueReset(touchQueue);
+    }
+}
+
+void touchInject(TouchEventType type, uint16_t x, uint16_t y)
+{
+    if (touchQueue != NULL)
+    {
+        sendEvent(type, x, y);
+    }
+}
+
+void touchRotateCalibration(uint16_t *calData, uint8_t from, uint8_t to)
+{
+    // calData is { x offset, x range, y offset, y range, flags }, the flags are 1 to swap the raw axes,
+    // 2 to invert x and 4 to invert y. Each quarter turn clockwise swaps the axes, and the new y runs
+    // against the old x.
+    for (uint8_t turns = (to - from) & 3; turns > 0; turns--)
+    {
+        uint16_t x0 = calData[0];
+        uint16_t x1 = calData[1];
+        bool swapXY = calData[4] & 1;
+        bool invertX = calData[4] & 2;
+        bool invertY = calData[4] & 4;
+
+        calData[0] = calData[2];
+        calData[1] = calData[3];
+        calData[2] = x0;
+        calData[3] = x1;
+        calData[4] = (swapXY ? 0 : 1) | (invertY ? 2 : 0) | (invertX ? 0 : 4);
+    }
+}
+
+static void setGesture(Gesture *gesture, GestureType type)
+{
+    gesture->type = type;
+    gesture->x = gestureStartX;
+    gesture->y = gestureStartY;
+    gesture->dy = 0;
+    gesture->velocity = 0;
+}
+
+bool gestureFeed(const TouchEvent &event, Gesture *gesture)
+{
+    int dx = (int)event.x - (int)gestureStartX;
+    int dy = (int)event.y - (int)gestureStartY;
+
+    switch (event.type)
+    {
+        case TOUCH_PRESS:
+            gestureActive = true;
+            gestureDragging = false;
+            gestureLongPressed = false;
+            gestureStartX = event.x;
+            gestureStartY = event.y;
+            gestureStartTime = event.time;
+            gestureLastY = event.y;
+            gestureLastTime = event.time;
+            gestureMaxDistance = 0;
+            gestureVelocity = 0;
+            return false;
+
+        case TOUCH_MOVE:
+        {
+            if (!gestureActive || gestureLongPressed)
+            {
+                return false;
+            }
+
+            uint16_t distance = max(abs(dx), abs(dy));
+            if (distance > gestureMaxDistance)
+            {
+                gestureMaxDistance = distance;
+            }
+
+            // Mostly vertical movement past the slop starts a drag. Sideways movement is left for swipes.
+            if (!gestureDragging && abs(dy) > GESTURE_SLOP && abs(dy) > abs(dx))
+            {
+                gestureDragging = true;
+            }
+            if (!gestureDragging)
+            {
+                return false;
+            }
+
+            int16_t step = (int)event.y - (int)gestureLastY;
+            uint32_t elapsed = event.time - gestureLastTime;
+            if (elapsed > 0)
+            {
+                // Smooth the velocity so a single noisy sample doesn't fling the list
+                gestureVelocity = (0.6 * gestureVelocity) + (0.4 * ((float)step / elapsed));
+            }
+            gestureLastY = event.y;
+            gestureLastTime = event.time;
+
+            setGesture(gesture, GESTURE_DRAG);
+            gesture->dy = step;
+            return true;
+        }
+
+        case TOUCH_RELEASE:
+        {
+            if (!gestureActive)
+            {
+                return false;
+            }
+            gestureActive = false;
+
+            if (gestureLongPressed)
+            {
+                return false; // Already reported
+            }
+            if (gestureDragging)
+            {
+                setGesture(gesture, GESTURE_DRAG_END);
+                // Finger stopped before lifting, so don't keep the list moving
+                gesture->velocity = (event.time - gestureLastTime > 100) ? 0 : gestureVelocity;
+                return true;
+            }
+            if (abs(dx) >= GESTURE_SWIPE_DISTANCE && abs(dx) > (2 * abs(dy)) && (event.time - gestureStartTime) <= GESTURE_SWIPE_TIME)
+            {
+                setGesture(gesture, (dx < 0) ? GESTURE_SWIPE_LEFT : GESTURE_SWIPE_RIGHT);
+                return true;
+            }
+            if (gestureMaxDistance <= GESTURE_SLOP)
+            {
+                setGesture(gesture, GESTURE_TAP);
+                return true;
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+bool gesturePoll(uint32_t now, Gesture *gesture)
+{
+    if (gestureActive && !gestureDragging && !gestureLongPressed && gestureMaxDistance <= GESTURE_SLOP
+        && (now - gestureStartTime) >= GESTURE_LONG_PRESS_TIME)
+    {
+        gestureLongPressed = true;
+        setGesture(gesture, GESTURE_LONG_PRESS);
+        return true;
+    }
+    return false;
+}
+
+void gestureCancel()
+{
+    gestureActive = false;
+}
@@ -0,0 +1,137 @@
+#include <trace.h>
+#include <arena.h>
+
+static SemaphoreHandle_t traceLock = NULL;
+
+// Counters since the last report. Requests are counted from several tasks, the rest only while the display is held.
+static volatile uint32_t benchRequests = 0;
+static uint32_t benchPixelCount = 0;
+static uint32_t benchFrames = 0;
+static uint32_t benchFrameTotal = 0;
+static uint32_t benchFrameMax = 0;
+static uint32_t benchLastReport = 0;
+
+static char traceCommand[TRACE_COMMAND_LEN];
+static uint8_t traceCommandLen = 0;
+
+void traceBegin()
+{
+    traceLock = xSemaphoreCreateMutex();
+}
+
+void traceResponse(const char *method, const String &request, int httpCode, const String &body)
+{
+#if RECORD_TRACE
+    if (traceLock == NULL || xSemaphoreTake(traceLock, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+    // JSON doesn't care about line breaks between tokens, and ones inside strings are escaped, so each
+    // response fits on one line
+    String line = body;
+    line.replace('\n', ' ');
+    line.replace('\r', ' ');
+    Serial.printf("TRACE %lu %s %d %s ", (unsigned long)millis(), method, httpCode, request.c_str());
+    Serial.println(line.length() > 0 ? line : String("-"));
+    xSemaphoreGive(traceLock);
+#endif
+}
+
+void traceTouch(const TouchEvent &event)
+{
+#if RECORD_TRACE
+    static const char *types[] = { "press", "move", "release" };
+    if (traceLock == NULL || xSemaphoreTake(traceLock, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+    Serial.printf("TRACE %lu touch %s %u %u\n", (unsigned long)event.time, types[event.type], event.x, event.y);
+    xSemaphoreGive(traceLock);
+#endif
+}
+
+void traceReadSerial()
+{
+#if BENCH_STATS
+    while (Serial.available() > 0)
+    {
+        char c = Serial.read();
+        if (c != '\n')
+        {
+            if (c != '\r' && traceCommandLen < TRACE_COMMAND_LEN - 1)
+            {
+                traceCommand[traceCommandLen++] = c;
+            }
+            continue;
+        }
+        traceCommand[traceCommandLen] = '\0';
+        traceCommandLen = 0;
+
+        char type[10];
+        unsigned int x, y;
+        if (sscanf(traceCommand, "touch %9s %u %u", type, &x, &y) != 3)
+        {
+            continue;
+        }
+        if (strcmp(type, "press") == 0) { touchInject(TOUCH_PRESS, x, y); }
+        else if (strcmp(type, "move") == 0) { touchInject(TOUCH_MOVE, x, y); }
+        else if (strcmp(type, "release") == 0) { touchInject(TOUCH_RELEASE, x, y); }
+    }
+#endif
+}
+
+void benchRequest()
+{
+#if BENCH_STATS
+    benchRequests++;
+#endif
+}
+
+void benchPixels(uint32_t pixels)
+{
+#if BENCH_STATS
+    benchPixelCount += pixels;
+#endif
+}
+
+void benchFrame(uint32_t micros)
+{
+#if BENCH_STATS
+    benchFrames++;
+    benchFrameTotal += micros;
+    if (micros > benchFrameMax)
+    {
+        benchFrameMax = micros;
+    }
+#endif
+}
+
+void benchReport(uint32_t now)
+{
+#if BENCH_STATS
+    if (now - benchLastReport < BENCH_REPORT_INTERVAL)
+    {
+        return;
+    }
+    benchLastReport = now;
+
+    if (traceLock == NULL || xSemaphoreTake(traceLock, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+    Serial.printf("STATS %lu frames=%lu frame_avg_us=%lu frame_max_us=%lu spi_bytes=%lu requests=%lu heap_free=%lu heap_min=%lu"
+        " refresh_arena_peak=%lu screen_arena_peak=%lu\n",
+        (unsigned long)now, (unsigned long)benchFrames,
+        (unsigned long)(benchFrames > 0 ? benchFrameTotal / benchFrames : 0), (unsigned long)benchFrameMax,
+        (unsigned long)(benchPixelCount * 2), (unsigned long)benchRequests,
+        (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+        (unsigned long)refreshArena.peak, (unsigned long)screenArena.peak);
+    xSemaphoreGive(traceLock);
+
+    benchFrames = 0;
+    benchFrameTotal = 0;
+    benchFrameMax = 0;
+    benchPixelCount = 0;
+    benchRequests = 0;
+#endif
+}
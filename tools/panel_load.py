@@ -0,0 +1,474 @@
+#!/usr/bin/python3
+
+"""Load test an AmpliPi with many virtual touchscreen panels
+
+Each virtual panel makes the requests the panel firmware makes, on the same schedule: at start it gets the
+stream list and prefetches the stream logos, it keeps a long poll on /api/changes open and refreshes every
+30 s while that works, or every 2 s when it doesn't. Each refresh gets its zones and source (in one request
+from /api/controller, or separately if the AmpliPi doesn't have it, or with --separate), gets the stream
+when it changes, downloads album art (preview, then full size) when the track changes and the art isn't in
+its art cache, and prefetches the next track's art. Documents are asked for as MessagePack, like the
+firmware does, when the msgpack module is installed. Panels also send commands, as a person would.
+
+The model is written by hand from src/main.cpp and src/artcache.cpp, of the 320x480 build on the selection
+screen. Any firmware change to what is requested, how often, or what is cached has to be made here too,
+or the load this reports is no longer the load real panels make.
+
+While the panels run, a marker task changes the volume of the panels' zones at known times. Each panel
+notes when it first shows the new volume, which gives the staleness of what panels display.
+
+Run from anywhere, pointing at an AmpliPi checkout (the directory holding amplipi/ and web/):
+  python3 tools/panel_load.py --amplipi-dir ~/AmpliPi --panels 200 --duration 60
+This starts create_app(mock_ctrl=True, mock_streams=True) in its own process so its CPU use can be
+measured, with a throwaway config. To load a running AmpliPi instead, use --url (and --server-pid for CPU).
+"""
+
+import argparse
+import collections
+import http.client
+import json
+import multiprocessing
+import os
+import random
+import sys
+import tempfile
+import threading
+import time
+import urllib.parse
+
+try:
+  import msgpack # optional, without it panels ask for JSON like older firmware
+except ImportError:
+  msgpack = None
+
+# Panel firmware behaviour, see src/main.cpp and include/artcache.h
+REFRESH_INTERVAL = 2.0      # REFRESH_INTERVAL
+CHANGES_TIMEOUT = 25        # CHANGES_TIMEOUT
+CHANGES_RETRY_INTERVAL = 2.0    # CHANGES_RETRY_INTERVAL
+CHANGES_REFRESH_INTERVAL = 30.0 # CHANGES_REFRESH_INTERVAL
+VOL_SEND_INTERVAL = 0.25    # VOL_SEND_INTERVAL
+ART_W = 200                 # layout.albumArt on a 320x480 panel
+ART_H = 200
+ART_PREFETCH_W = 320        # ART_PREFETCH_W, layout.albumArtFull.w
+ART_PREVIEW_SCALE = 8       # ART_PREVIEW_SCALE
+ART_CACHE_BUDGET = 65536    # ART_CACHE_BUDGET
+ART_CACHE_ENTRY_MAX = 24576 # ART_CACHE_ENTRY_MAX
+ART_CACHE_ENTRIES = 24      # ART_CACHE_ENTRIES
+ART_HEADER_SIZE = 6         # sizeof(ArtHeader)
+ACCEPT = 'application/msgpack, application/json;q=0.5' # acceptDocument()
+TIMEOUT = 5                 # Request timeout
+
+def serve(amplipi_dir, port, ready):
+  """ Run the mock AmpliPi, in its own process """
+  os.chdir(amplipi_dir)
+  sys.path.insert(0, amplipi_dir)
+  from werkzeug.serving import make_server
+  import amplipi.app
+  config = os.path.join(tempfile.mkdtemp(prefix='panel-load-'), 'house.json')
+  app = amplipi.app.create_app(mock_ctrl=True, mock_streams=True, config_file=config)
+  server = make_server('127.0.0.1', port, app, threaded=True)
+  ready.set()
+  server.serve_forever()
+
+def process_cpu(pid):
+  """ CPU seconds used by a process so far, or None if it can't be read """
+  try:
+    with open('/proc/{}/stat'.format(pid)) as stat:
+      fields = stat.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+  except (OSError, IndexError, ValueError):
+    pass
+  try:
+    import psutil
+    times = psutil.Process(pid).cpu_times()
+    return times.user + times.system
+  except Exception:
+    return None
+
+def art_key(url):
+  """ artKey(), 32 bit FNV-1a of the url """
+  key = 2166136261
+  for b in url.encode():
+    key = ((key ^ b) * 16777619) & 0xFFFFFFFF
+  return key
+
+def percentile(values, p):
+  if not values:
+    return None
+  values = sorted(values)
+  return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+class Stats:
+  """ Request latencies by kind, and staleness samples, collected from all panels """
+
+  def __init__(self):
+    self.lock = threading.Lock()
+    self.latency = collections.defaultdict(list)
+    self.errors = collections.Counter()
+    self.staleness = []
+
+  def request(self, kind, seconds, ok):
+    with self.lock:
+      self.latency[kind].append(seconds)
+      if not ok:
+        self.errors[kind] += 1
+
+class Client:
+  """ Plain HTTP requests to the AmpliPi API, one connection per request like the firmware """
+
+  def __init__(self, host, port, stats, accept):
+    self.host = host
+    self.port = port
+    self.stats = stats
+    self.accept = accept
+
+  def request(self, kind, method, path, body=None, timeout=TIMEOUT):
+    """ Returns the status, body and Content-Type. Requests that fail to connect have status 0. """
+    start = time.monotonic()
+    status, data, content_type = 0, b'', ''
+    try:
+      conn = http.client.HTTPConnection(self.host, self.port, timeout=timeout)
+      headers = { 'Content-Type': 'application/json' } if body is not None else { 'Accept': self.accept }
+      conn.request(method, '/api/' + path, body=json.dumps(body) if body is not None else None, headers=headers)
+      resp = conn.getresponse()
+      status, data, content_type = resp.status, resp.read(), resp.getheader('Content-Type', '')
+      conn.close()
+    except (OSError, http.client.HTTPException):
+      pass
+    self.stats.request(kind, time.monotonic() - start, status in (200, 204))
+    return status, data, content_type
+
+  def get_doc(self, kind, path, timeout=TIMEOUT):
+    """ GET a document, as readDocument() takes it: MessagePack or JSON by its Content-Type. Returns the status and the document or None. """
+    status, data, content_type = self.request(kind, 'GET', path, timeout=timeout)
+    if status != 200:
+      return status, None
+    try:
+      if content_type.startswith('application/msgpack'):
+        return status, msgpack.unpackb(data, raw=False)
+      return status, json.loads(data)
+    except ValueError:
+      return status, None
+
+class ArtCache:
+  """ The panel's flash art cache: entries by url key and width, least recently used dropped first """
+
+  def __init__(self):
+    self.entries = collections.OrderedDict() # (key, width) -> size
+
+  def has(self, key, width):
+    return (key, width) in self.entries
+
+  def open(self, key, width):
+    """ artCacheOpen(), which counts as a use """
+    if not self.has(key, width):
+      return False
+    self.entries.move_to_end((key, width))
+    return True
+
+  def add(self, key, width, size):
+    """ artCacheCreate() and artCacheFinish() """
+    if size > ART_CACHE_ENTRY_MAX:
+      return
+    self.entries.pop((key, width), None)
+    while self.entries and (len(self.entries) >= ART_CACHE_ENTRIES
+        or sum(self.entries.values()) + size + ART_HEADER_SIZE > ART_CACHE_BUDGET):
+      self.entries.popitem(last=False)
+    self.entries[(key, width)] = size + ART_HEADER_SIZE
+
+class Markers:
+  """ Volume changes made at known times, so panels can tell how late they saw them """
+
+  def __init__(self):
+    self.lock = threading.Lock()
+    self.changes = {} # zone -> (vol, time set)
+
+  def set(self, zone, vol, when):
+    with self.lock:
+      self.changes[zone] = (vol, when)
+
+  def get(self, zone):
+    with self.lock:
+      return self.changes.get(zone)
+
+class Panel(threading.Thread):
+  """ One virtual panel controlling a source and one or two zones """
+
+  def __init__(self, client, source, zones, markers, args, stop):
+    super().__init__(daemon=True)
+    self.client = client
+    self.stats = client.stats
+    self.source = source
+    self.zones = zones
+    self.markers = markers
+    self.args = args
+    self.stop = stop
+    self.shown = {} # zone -> {'vol', 'mute'} as displayed
+    self.seen_markers = {}
+    self.stream_id = None
+    self.img_url = None
+    self.next_img_url = None
+    self.controller_route = not args.separate
+    self.changes_active = False # The AmpliPi is answering long polls
+    self.art = ArtCache()
+    self.lock = threading.Lock() # What's shown is updated by the refresh and the long poll
+
+  def run(self):
+    # Panels don't start in step
+    if self.stop.wait(random.uniform(0, REFRESH_INTERVAL)):
+      return
+    self.load_streams()
+    if self.controller_route and not self.args.no_long_poll:
+      threading.Thread(target=self.changes, daemon=True).start()
+    next_command = time.monotonic() + self.command_delay()
+    last_refresh = None
+    while not self.stop.is_set():
+      # Like loop(), the interval is checked often so the 2 s refresh resumes as soon as the long poll fails
+      interval = CHANGES_REFRESH_INTERVAL if self.changes_active else REFRESH_INTERVAL
+      if last_refresh is None or time.monotonic() - last_refresh >= interval:
+        last_refresh = time.monotonic()
+        self.refresh()
+      if self.args.commands and time.monotonic() >= next_command:
+        self.command()
+        next_command = time.monotonic() + self.command_delay()
+      self.stop.wait(0.25)
+
+  def changes(self):
+    """ changesLoop(), the long poll the firmware runs on its own task """
+    query = 'changes?source={}&zones={}&timeout={}'.format(self.source, ','.join(str(z) for z in self.zones), CHANGES_TIMEOUT)
+    since = 0
+    while not self.stop.is_set() and self.controller_route:
+      status, doc = self.client.get_doc('changes', query + '&since={}'.format(since), timeout=CHANGES_TIMEOUT + 5)
+      if status == 200 and doc is not None:
+        since = doc.get('version', 0)
+        self.show_controller(doc)
+        self.changes_active = True
+      elif status == 204:
+        self.changes_active = True # Nothing changed
+      else:
+        self.changes_active = False
+        if status == 404:
+          return # An older AmpliPi, stay with the timed refresh
+        self.stop.wait(CHANGES_RETRY_INTERVAL)
+    self.changes_active = False
+
+  def command_delay(self):
+    return random.expovariate(self.args.commands / 60.0) if self.args.commands else 0
+
+  def prefetch(self, key, width, path):
+    """ artPrefetch(). The firmware runs these on its own task when the panel is idle, here they run in line. """
+    if self.art.has(key, width):
+      return
+    status, data, content_type = self.client.request('prefetch', 'GET', path + '&url_hash={:x}'.format(key))
+    if status == 200 and content_type.startswith('application/x-rgb565'):
+      self.art.add(key, width, len(data))
+
+  def load_streams(self):
+    """ loadStreamList() at startup, which prefetches the stream logos """
+    _, doc = self.client.get_doc('streams', 'streams')
+    for stream in (doc or {}).get('streams', []):
+      if stream.get('logo'):
+        self.prefetch(art_key(stream['logo']), ART_PREFETCH_W, 'streams/image/{}?width={}&height={}&format=rle565'.format(
+          stream['id'], ART_PREFETCH_W, ART_H))
+
+  def refresh(self):
+    """ getControllerState(), or getZone() and getSource() """
+    if self.controller_route:
+      status, doc = self.client.get_doc('controller', 'controller/{}?zones={}'.format(
+        self.source, ','.join(str(z) for z in self.zones)))
+      if status != 404:
+        if doc is not None:
+          self.show_controller(doc)
+        return
+      self.controller_route = False
+    for zone in self.zones:
+      _, status = self.client.get_doc('zone', 'zones/{}'.format(zone))
+      if status is not None:
+        with self.lock:
+          self.show_zone(zone, status)
+    _, source = self.client.get_doc('source', 'sources/{}'.format(self.source))
+    if source is not None:
+      with self.lock:
+        self.show_source(source, None)
+
+  def show_controller(self, doc):
+    """ applyControllerState() """
+    with self.lock:
+      for zone in doc['zones']:
+        self.show_zone(zone['id'], zone)
+      self.show_source(doc['source'], doc['stream'])
+
+  def show_source(self, source, stream):
+    """ applySourceStatus() """
+    stream_input = source.get('input', '')
+    stream_id = stream_input[len('stream='):] if stream_input.startswith('stream=') else None
+    if stream_id and stream_id != self.stream_id and stream is None:
+      self.client.get_doc('stream', 'streams/{}'.format(stream_id))
+    self.stream_id = stream_id
+
+    info = source.get('info') or {}
+    img_url = info.get('img_url') or ''
+    if img_url != self.img_url:
+      self.img_url = img_url
+      key = art_key(img_url)
+      if not self.art.open(key, ART_W):
+        base = 'sources/{}/image/'.format(self.source)
+        preview_w, preview_h = ART_W // ART_PREVIEW_SCALE, ART_H // ART_PREVIEW_SCALE
+        self.client.request('image', 'GET', base + '{}?height={}&format=rgb565'.format(preview_w, preview_h))
+        status, data, content_type = self.client.request('image', 'GET', base + '{}?height={}&format=rle565'.format(ART_W, ART_H))
+        if status == 200 and content_type.startswith('application/x-rgb565'):
+          self.art.add(key, ART_W, len(data))
+    next_img_url = info.get('next_img_url')
+    if next_img_url and next_img_url != self.next_img_url:
+      self.next_img_url = next_img_url
+      self.prefetch(art_key(next_img_url), ART_W, 'sources/{}/image/{}?height={}&format=rle565&next=1'.format(
+        self.source, ART_W, ART_H))
+
+  def show_zone(self, zone, status):
+    now = time.monotonic()
+    self.shown[zone] = { 'vol': status.get('vol'), 'mute': status.get('mute') }
+    marker = self.markers.get(zone)
+    if marker is None or self.seen_markers.get(zone) == marker:
+      return
+    vol, when = marker
+    if status.get('vol') == vol:
+      self.seen_markers[zone] = marker
+      with self.stats.lock:
+        self.stats.staleness.append(now - when)
+
+  def command(self):
+    """ A tap on mute, or a short drag of a volume bar """
+    zone = random.choice(self.zones)
+    if self.args.drags and random.random() < 0.5:
+      vol = self.shown.get(zone, {}).get('vol') or -40
+      for _ in range(4):
+        vol = max(-79, min(0, vol + random.choice([-3, 3])))
+        self.client.request('patch', 'PATCH', 'zones/{}'.format(zone), { 'vol': vol })
+        if self.stop.wait(VOL_SEND_INTERVAL):
+          return
+    else:
+      mute = not self.shown.get(zone, {}).get('mute', False)
+      self.client.request('patch', 'PATCH', 'zones/{}'.format(zone), { 'mute': mute })
+      # Tap it again a moment later so the zone isn't left muted
+      if not self.stop.wait(1.0):
+        self.client.request('patch', 'PATCH', 'zones/{}'.format(zone), { 'mute': not mute })
+
+def change_markers(client, zones, markers, interval, stop):
+  """ Change each zone's volume every interval and remember when """
+  vols = [-50, -45]
+  i = 0
+  while not stop.wait(interval):
+    for zone in zones:
+      vol = vols[i % 2]
+      # Only counts as a marker once the AmpliPi has accepted it
+      status, _, _ = client.request('marker', 'PATCH', 'zones/{}'.format(zone), { 'vol': vol })
+      if status == 200:
+        markers.set(zone, vol, time.monotonic())
+    i += 1
+
+def report(stats, elapsed, cpu, panels):
+  total = sum(len(v) for k, v in stats.latency.items() if k != 'marker')
+  result = {
+    'panels': panels,
+    'seconds': round(elapsed, 1),
+    'requests_per_second': round(total / elapsed, 1),
+    'server_cpu_percent': round(100 * cpu / elapsed, 1) if cpu is not None else None,
+    'latency_ms': {},
+    'errors': dict(stats.errors),
+  }
+  all_latency = []
+  for kind, values in sorted(stats.latency.items()):
+    if kind == 'marker':
+      continue
+    if kind != 'changes': # Long polls are held on purpose, their time isn't latency
+      all_latency += values
+    result['latency_ms'][kind] = {
+      'count': len(values),
+      'p50': round(1000 * percentile(values, 50), 1),
+      'p99': round(1000 * percentile(values, 99), 1),
+    }
+  if all_latency:
+    result['latency_ms']['all'] = {
+      'count': len(all_latency),
+      'p50': round(1000 * percentile(all_latency, 50), 1),
+      'p99': round(1000 * percentile(all_latency, 99), 1),
+    }
+  if stats.staleness:
+    result['staleness_ms'] = {
+      'samples': len(stats.staleness),
+      'p50': round(1000 * percentile(stats.staleness, 50)),
+      'p99': round(1000 * percentile(stats.staleness, 99)),
+      'max': round(1000 * max(stats.staleness)),
+    }
+  return result
+
+def main():
+  parser = argparse.ArgumentParser(description='Load test an AmpliPi with virtual touchscreen panels')
+  parser.add_argument('--panels', type=int, default=100)
+  parser.add_argument('--duration', type=float, default=60, help='Seconds to run for')
+  parser.add_argument('--amplipi-dir', help='AmpliPi checkout to run the mock server from')
+  parser.add_argument('--port', type=int, default=5055, help='Port for the mock server')
+  parser.add_argument('--url', help='Load a running AmpliPi instead, e.g. http://amplipi.local')
+  parser.add_argument('--server-pid', type=int, help='Process of the running AmpliPi, to measure its CPU use')
+  parser.add_argument('--sources', type=int, default=4, help='Panels are spread over this many sources')
+  parser.add_argument('--zones', type=int, default=6, help='and this many zones')
+  parser.add_argument('--two-zone', type=float, default=0.3, help='Share of panels in two zone mode')
+  parser.add_argument('--commands', type=float, default=1.0, help='Commands per panel per minute')
+  parser.add_argument('--separate', action='store_true', help='Poll zones and source separately, like older firmware')
+  parser.add_argument('--no-long-poll', action='store_true', help='Only the timed refresh, like firmware before /api/changes')
+  parser.add_argument('--drags', action='store_true', help='Commands include volume drags (may hide staleness samples)')
+  parser.add_argument('--marker-interval', type=float, default=5.0, help='Seconds between staleness markers')
+  args = parser.parse_args()
+
+  server = None
+  pid = args.server_pid
+  if args.url:
+    url = urllib.parse.urlparse(args.url)
+    host, port = url.hostname, url.port or 80
+  elif args.amplipi_dir:
+    ready = multiprocessing.Event()
+    server = multiprocessing.Process(target=serve, args=(os.path.abspath(args.amplipi_dir), args.port, ready), daemon=True)
+    server.start()
+    if not ready.wait(30):
+      sys.exit('Mock AmpliPi did not start')
+    host, port, pid = '127.0.0.1', args.port, server.pid
+  else:
+    sys.exit('Give --amplipi-dir to run the mock AmpliPi, or --url of a running one')
+
+  if msgpack is None:
+    print('msgpack is not installed, panels ask for JSON', file=sys.stderr)
+  stats = Stats()
+  client = Client(host, port, stats, ACCEPT if msgpack is not None else 'application/json')
+  markers = Markers()
+  stop = threading.Event()
+  panels = []
+  for i in range(args.panels):
+    zones = [i % args.zones]
+    if random.random() < args.two_zone:
+      zones.append((i + 1) % args.zones)
+    panels.append(Panel(client, i % args.sources, zones, markers, args, stop))
+
+  cpu_start = process_cpu(pid) if pid else None
+  start = time.monotonic()
+  for panel in panels:
+    panel.start()
+  marker_zones = sorted(set(z for p in panels for z in p.zones))
+  threading.Thread(target=change_markers, args=(client, marker_zones, markers, args.marker_interval, stop), daemon=True).start()
+
+  try:
+    stop.wait(args.duration)
+  except KeyboardInterrupt:
+    pass
+  stop.set()
+  elapsed = time.monotonic() - start
+  cpu_end = process_cpu(pid) if pid else None
+  cpu = (cpu_end - cpu_start) if cpu_start is not None and cpu_end is not None else None
+  for panel in panels:
+    panel.join(TIMEOUT + 1)
+
+  print(json.dumps(report(stats, elapsed, cpu, args.panels), indent=2))
+  if server is not None:
+    server.terminate()
+
+if __name__ == '__main__':
+  main()
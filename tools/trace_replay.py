@@ -0,0 +1,282 @@
+#!/usr/bin/python3
+
+"""Trace replay for the AmpliPi POE Touchscreen
+
+Plays a session recorded on a real panel back to a panel on the bench, so field performance problems
+can be reproduced and every performance change can be measured against the same session.
+
+This is a hardware-in-the-loop tool: the firmware under test runs on a real panel, and the numbers come
+from that panel's STATS lines. It is not a host harness, nothing here runs the firmware on a PC. Without a
+panel there are no frame times to report, use tools/panel_load.py to model request load on the AmpliPi.
+
+1. Record: build with -DRECORD_TRACE=1, use the panel, and save its Serial output, e.g.
+     pio device monitor | tee session.log
+   Only the lines starting with TRACE are used, the rest of the log is ignored.
+2. Replay: build with -DBENCH_STATS=1 and DEBUG_WEBSERVER true, point the panel at the machine running
+   this script, and run
+     python3 tools/trace_replay.py session.log --port /dev/ttyUSB0 [--art cover.jpg] [--duration 120]
+   This serves the recorded API responses on port 5000, as the AmpliPi would have sent them at that point
+   of the session, and types the recorded touches into the panel's Serial port at the recorded times.
+   The panel's STATS lines are printed as they come and summarized at the end.
+
+Without --port only the API is replayed, for example to watch the panel by eye.
+Album art isn't recorded, every image request is answered with the --art file or a 404. The file is
+scaled and encoded as the request asks (jpg, rgb565 or rle565) by amplipi/thumbs.py, the same code the
+AmpliPi uses, so the panel decodes the same kind of data it would in the field. That needs PIL.
+"""
+
+import argparse
+import bisect
+import collections
+import json
+import os
+import sys
+import threading
+import time
+import urllib.parse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+
+Response = collections.namedtuple('Response', ['time', 'code', 'body'])
+Touch = collections.namedtuple('Touch', ['time', 'type', 'x', 'y'])
+
+def load_trace(filename):
+  """ Read TRACE lines from a Serial log. Times are made relative to the first line. """
+  responses = collections.defaultdict(list) # (method, request) -> [Response] in time order
+  touches = []
+  start = None
+  with open(filename, errors='replace') as log:
+    for line in log:
+      idx = line.find('TRACE ')
+      if idx < 0:
+        continue
+      parts = line[idx:].rstrip('\r\n').split(' ', 5)
+      if len(parts) < 5:
+        continue
+      try:
+        ms = int(parts[1])
+      except ValueError:
+        continue
+      if start is None:
+        start = ms
+      t = (ms - start) / 1000.0
+      if parts[2] == 'touch' and len(parts) == 6:
+        touches.append(Touch(t, parts[3], int(parts[4]), int(parts[5])))
+      elif len(parts) == 6:
+        method, code, request, body = parts[2], int(parts[3]), parts[4], parts[5]
+        responses[(method, request)].append(Response(t, code, '' if body == '-' else body))
+  return responses, touches
+
+class Replay:
+  """ Serves responses and keeps count of what was asked for """
+
+  def __init__(self, responses, art, speed):
+    self.responses = responses
+    self.times = { key: [r.time for r in rs] for key, rs in responses.items() }
+    self.art = art
+    self.speed = speed
+    self.start = None
+    self.requests = collections.Counter()
+    self.missing = collections.Counter()
+    self.lock = threading.Lock()
+    self.thumbs = {} # (width, height, format) -> Thumb of the --art file
+
+  def image(self, request):
+    """ The --art file encoded the way an image request asks for, see get_source_image in amplipi/app.py """
+    if not self.art:
+      return None
+    path, _, query = request.partition('?')
+    args = urllib.parse.parse_qs(query)
+    if path.startswith('sources/'):
+      width = int(path.rsplit('/', 1)[-1]) # sources/<sid>/image/<width>
+    else:
+      width = int(args.get('width', ['200'])[0]) # streams/image/<sid>?width=
+    height = int(args.get('height', [width])[0])
+    fmt = args.get('format', ['jpg'])[0]
+    key = (width, height, fmt)
+    with self.lock:
+      if key not in self.thumbs:
+        from amplipi.thumbs import make_thumb # needs PIL, only loaded when there is art to serve
+        self.thumbs[key] = make_thumb(self.art, width, height, fmt)
+      return self.thumbs[key]
+
+  def elapsed(self):
+    """ Session time, starting at the panel's first request """
+    with self.lock:
+      if self.start is None:
+        self.start = time.monotonic()
+      return (time.monotonic() - self.start) * self.speed
+
+  def lookup(self, method, request):
+    """ The response the AmpliPi gave to this request most recently at this point of the session """
+    t = self.elapsed()
+    with self.lock:
+      self.requests[method] += 1
+    key = (method, request)
+    if key not in self.responses:
+      # Fall back to the same path with other query arguments
+      path = request.split('?')[0]
+      key = next((k for k in self.responses if k[0] == method and k[1].split('?')[0] == path), None)
+      if key is None:
+        with self.lock:
+          self.missing[(method, request)] += 1
+        return None
+    i = bisect.bisect_right(self.times[key], t) - 1
+    if request.startswith('changes?') and self.responses[key][max(i, 0)].code == 200:
+      # A long poll was answered when something changed, hold it until the next recorded answer
+      if i + 1 >= len(self.times[key]):
+        return Response(t, 204, '')
+      time.sleep((self.times[key][i + 1] - t) / self.speed)
+      i += 1
+    return self.responses[key][max(i, 0)]
+
+def make_handler(replay):
+  class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+
+    def log_message(self, format, *args):
+      pass
+
+    def send_body(self, code, body, content_type):
+      self.send_response(code)
+      self.send_header('Content-Type', content_type)
+      self.send_header('Content-Length', str(len(body)))
+      self.end_headers()
+      self.wfile.write(body)
+
+    def answer(self, method):
+      length = int(self.headers.get('Content-Length', 0))
+      if length:
+        self.rfile.read(length)
+      if not self.path.startswith('/api/'):
+        self.send_body(404, b'', 'text/plain')
+        return
+      request = self.path[len('/api/'):]
+      if method == 'GET' and '/image' in request:
+        replay.lookup('ART', request)
+        thumb = replay.image(request)
+        if thumb is None:
+          self.send_body(404, b'', 'text/plain')
+        elif self.headers.get('If-None-Match', '').strip('"') == thumb.etag:
+          self.send_response(304)
+          self.send_header('Content-Length', '0')
+          self.end_headers()
+        else:
+          from amplipi.thumbs import THUMB_MIMETYPES
+          self.send_response(200)
+          self.send_header('Content-Type', THUMB_MIMETYPES[thumb.kind])
+          self.send_header('Content-Length', str(len(thumb.data)))
+          self.send_header('X-Image-Width', str(thumb.width))
+          self.send_header('X-Image-Height', str(thumb.height))
+          self.send_header('ETag', '"{}"'.format(thumb.etag))
+          self.end_headers()
+          self.wfile.write(thumb.data)
+        return
+      resp = replay.lookup(method, request)
+      if resp is None:
+        # Not in the trace, commands still succeed so the panel carries on
+        code, body = (200, '{}') if method != 'GET' else (404, '{"error": "not in trace"}')
+      else:
+        code, body = resp.code, resp.body or '{}'
+      self.send_body(code, body.encode() if code != 204 else b'', 'application/json')
+
+    def do_GET(self):
+      self.answer('GET')
+
+    def do_PATCH(self):
+      self.answer('PATCH')
+
+    def do_POST(self):
+      self.answer('POST')
+
+  return Handler
+
+def play_touches(panel, touches, replay, stop):
+  """ Type the recorded touches into the panel at the recorded times """
+  for touch in touches:
+    while not stop.is_set() and replay.start is None:
+      time.sleep(0.05) # Wait for the panel to start talking to us
+    delay = touch.time - replay.elapsed()
+    if delay > 0 and stop.wait(delay / replay.speed):
+      return
+    panel.write('touch {} {} {}\n'.format(touch.type, touch.x, touch.y).encode())
+
+def read_stats(panel, stats, stop):
+  """ Collect the panel's STATS lines """
+  while not stop.is_set():
+    line = panel.readline().decode(errors='replace').strip()
+    idx = line.find('STATS ')
+    if idx < 0:
+      continue
+    print(line[idx:])
+    fields = dict(f.split('=', 1) for f in line[idx:].split(' ')[2:] if '=' in f)
+    stats.append({ k: int(v) for k, v in fields.items() })
+
+def summarize(stats, replay):
+  """ One result for the whole replay, to compare between builds """
+  summary = { 'requests_served': dict(replay.requests), 'not_in_trace': len(replay.missing) }
+  if stats:
+    frames = sum(s['frames'] for s in stats)
+    summary.update({
+      'reports': len(stats),
+      'frames': frames,
+      'frame_avg_us': sum(s['frame_avg_us'] * s['frames'] for s in stats) // max(frames, 1),
+      'frame_max_us': max(s['frame_max_us'] for s in stats),
+      'spi_bytes': sum(s['spi_bytes'] for s in stats),
+      'requests': sum(s['requests'] for s in stats),
+      'heap_min': min(s['heap_min'] for s in stats),
+    })
+  return summary
+
+def main():
+  parser = argparse.ArgumentParser(description='Replay a recorded session to a panel and report its performance')
+  parser.add_argument('trace', help='Serial log of a RECORD_TRACE build')
+  parser.add_argument('--port', help='Serial port of the panel, to replay touches and read its stats')
+  parser.add_argument('--baud', type=int, default=115200)
+  parser.add_argument('--listen', default='0.0.0.0:5000', help='Address to serve the API on')
+  parser.add_argument('--art', help='Image sent for every album art request, in the format the request asks for')
+  parser.add_argument('--speed', type=float, default=1.0, help='Replay faster (>1) or slower (<1) than recorded')
+  parser.add_argument('--duration', type=float, help='Stop after this many seconds, default is the length of the trace')
+  args = parser.parse_args()
+
+  responses, touches = load_trace(args.trace)
+  if not responses:
+    sys.exit('No TRACE lines in ' + args.trace)
+  length = max([r.time for rs in responses.values() for r in rs] + [t.time for t in touches])
+  print('Loaded {} responses to {} requests and {} touches, {:.0f} s'.format(
+    sum(len(rs) for rs in responses.values()), len(responses), len(touches), length))
+
+  art = open(args.art, 'rb').read() if args.art else None
+  replay = Replay(responses, art, args.speed)
+  host, port = args.listen.rsplit(':', 1)
+  server = ThreadingHTTPServer((host, int(port)), make_handler(replay))
+  threading.Thread(target=server.serve_forever, daemon=True).start()
+
+  stop = threading.Event()
+  stats = []
+  if args.port:
+    import serial # pyserial, only needed to talk to the panel
+    panel = serial.Serial(args.port, args.baud, timeout=0.5)
+    threading.Thread(target=play_touches, args=(panel, touches, replay, stop), daemon=True).start()
+    threading.Thread(target=read_stats, args=(panel, stats, stop), daemon=True).start()
+
+  print('Serving on {}, waiting for the panel'.format(args.listen))
+  duration = args.duration if args.duration else length / args.speed
+  try:
+    while replay.start is None:
+      time.sleep(0.1)
+    time.sleep(duration)
+  except KeyboardInterrupt:
+    pass
+  stop.set()
+  server.shutdown()
+
+  if replay.missing:
+    print('Requests not in the trace:')
+    for (method, request), count in replay.missing.most_common(10):
+      print('  {} {} x{}'.format(method, request, count))
+  print(json.dumps(summarize(stats, replay), indent=2))
+
+if __name__ == '__main__':
+  main()